@@ -1,4 +1,4 @@
-#include <ctime>
+#include <chrono>
 #include "graph.h"
 
 int main(int argc, char** argv){
@@ -9,6 +9,19 @@ int main(int argc, char** argv){
     std::string bfsType = argv[2];
     std::string graphType = argv[3];
 
+    // The optional 4th argument is the # of threads used by the parallel bfs.
+    // The optional 5th and 6th arguments are the capacity and the replacement 
+    // policy (fifo, lru or degree) of the hub cache.
+    if(argc > 4){
+        GL::threadNum = atoi(argv[4]);
+    }
+    int cacheCapacity = 0;
+    std::string cachePolicy = "fifo";
+    if(argc > 6){
+        cacheCapacity = atoi(argv[5]);
+        cachePolicy = argv[6];
+    }
+
     Graph* gptr;
     if(graphType == "dblp"){
         gptr = new Graph("/home/liucheng/gitrepo/graph-data/dblp.ungraph.txt");
@@ -56,6 +69,7 @@ int main(int argc, char** argv){
     gptr->getRandomStartIndices(startIndices);
     //gptr->getStat();
     CSR* csrPtr = new CSR(*gptr);
+    csrPtr->setCacheParam(cacheCapacity, cachePolicy);
     //csrPtr->degreeAnalysis();
     if(graphType == "dblp"){
         csrPtr->setBfsParam(0.2, 5000, 128, 64, 1024);
@@ -84,7 +98,7 @@ int main(int argc, char** argv){
     double totalTime = 0;
     for(auto idx : startIndices){
         std::cout << "startIdx = " << idx << std::endl;
-        std::clock_t begin = clock();
+        auto begin = std::chrono::steady_clock::now();
         if(bfsType == "basic"){
             csrPtr->basicBfs(idx, fhandle);
         }
@@ -97,10 +111,11 @@ int main(int argc, char** argv){
         else if(bfsType == "hybrid"){
             csrPtr->hybridBfs(idx, fhandle);
         }
+        else if(bfsType == "parallel"){
+            csrPtr->parallelBfs(idx, fhandle);
+        }
         else if(bfsType == "cache"){
             csrPtr->cacheHybridBfs(idx, fhandle);
-            std::cout << "potential cache saving: ";
-            std::cout << csrPtr->getPotentialCacheSaving() << std::endl;
         }
         else{
             HERE;
@@ -108,8 +123,9 @@ int main(int argc, char** argv){
             exit(EXIT_FAILURE);
         }
 
-        std::clock_t end = clock();
-        double elapsedTime = double(end - begin)/CLOCKS_PER_SEC;
+        // Wall time rather than cpu time, which sums up all the threads.
+        auto end = std::chrono::steady_clock::now();
+        double elapsedTime = std::chrono::duration<double>(end - begin).count();
         totalTime += elapsedTime;
     }
     fhandle.close();
@@ -1,6 +1,75 @@
 #include "graph.h"
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <climits>
+
+// The depth is kept in int8_t for the vectorized scans. A bfs that gets 
+// to level INT8_MAX would write depths that wrap around, so it is stopped.
+static void checkDepthLimit(int level){
+    if(level >= INT8_MAX){
+        HERE;
+        std::cout << "The bfs reaches level " << level << ", beyond which ";
+        std::cout << "the int8_t depth would wrap around." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
 
 int GL::burstlen = 64;
+int GL::threadNum = 0;
+
+int GL::getThreadNum(){
+    if(threadNum > 0){
+        return threadNum;
+    }
+    int num = (int)std::thread::hardware_concurrency();
+    return num > 0 ? num : 1;
+}
+
+void GL::parallelFor(
+        long begin, 
+        long end, 
+        const std::function<void(int, long, long)> &func)
+{
+    int num = getThreadNum();
+    long len = (end - begin + num - 1) / num;
+    std::vector<std::thread> threads;
+    for(int tid = 1; tid < num; tid++){
+        long rangeBegin = std::min(end, begin + tid * len);
+        long rangeEnd = std::min(end, rangeBegin + len);
+        threads.push_back(std::thread(func, tid, rangeBegin, rangeEnd));
+    }
+    func(0, begin, std::min(end, begin + len));
+    for(auto &t : threads){
+        t.join();
+    }
+}
+
+// Prefix sum of vec[1..n] in place with vec[0] left at 0, which turns
+// the degrees in vec[1..n] into the row pointers. Each thread sums up a
+// continuous range first and then adds the sum of all the ranges before it.
+static void prefixSum(std::vector<int> &vec){
+    std::vector<int> rangeSum(GL::getThreadNum(), 0);
+    long n = (long)vec.size() - 1;
+    GL::parallelFor(1, n + 1, [&vec, &rangeSum](int tid, long begin, long end){
+        for(long i = begin + 1; i < end; i++){
+            vec[i] += vec[i - 1];
+        }
+        rangeSum[tid] = (begin < end) ? vec[end - 1] : 0;
+    });
+
+    for(int i = 1; i < (int)rangeSum.size(); i++){
+        rangeSum[i] += rangeSum[i - 1];
+    }
+
+    GL::parallelFor(1, n + 1, [&vec, &rangeSum](int tid, long begin, long end){
+        if(tid == 0) return;
+        for(long i = begin; i < end; i++){
+            vec[i] += rangeSum[tid - 1];
+        }
+    });
+}
 
 void Graph::loadFile(
         const std::string& fname, 
@@ -116,6 +185,13 @@ Graph::Graph(const std::string& fname){
     }
 }
 
+// The hub cache is not limited when the capacity is not positive.
+void CSR::setCacheParam(int _cacheCapacity, const std::string &_cachePolicy){
+    cacheCapacity = _cacheCapacity;
+    cachePolicy = _cachePolicy;
+    HubCache::getPolicy(cachePolicy);
+}
+
 void CSR::setBfsParam(
         float _alpha, 
         float _beta, 
@@ -138,6 +214,8 @@ CSR::CSR(const Graph &g) : vNum(g.vertexNum), eNum(g.edgeNum){
     hubVertexThreshold = 1024;
     cacheThreshold = 256;
     bucketNum = 1024;
+    cacheCapacity = 0;
+    cachePolicy = "fifo";
 
     // Assign random data to weight though it is not used in bfs.
     weight.resize(eNum);
@@ -145,37 +223,42 @@ CSR::CSR(const Graph &g) : vNum(g.vertexNum), eNum(g.edgeNum){
         w = (rand()%100)/10.0;
     }
 
+    // Degree histogram, prefix sum and scatter are all done in parallel.
+    // Each thread copies the neighbours of a continuous range of vertices, 
+    // so the arrays are the same with the sequential construction.
     rpao.resize(vNum+1);
     rpai.resize(vNum+1);
     rpao[0] = 0;
     rpai[0] = 0;
-    for(int i = 0; i < vNum; i++){
-        rpao[i+1] = rpao[i] + g.vertices[i]->outDeg;
-        rpai[i+1] = rpai[i] + g.vertices[i]->inDeg;
-    }
-
-    for(int i = 0; i < vNum; i++){
-        for(auto id : g.vertices[i]->outVid){
-            ciao.push_back(id);
+    GL::parallelFor(0, vNum, [this, &g](int tid, long begin, long end){
+        for(long i = begin; i < end; i++){
+            rpao[i+1] = g.vertices[i]->outDeg;
+            rpai[i+1] = g.vertices[i]->inDeg;
         }
-        for(auto id : g.vertices[i]->inVid){
-            ciai.push_back(id);
+    });
+    prefixSum(rpao);
+    prefixSum(rpai);
+
+    ciao.resize(rpao[vNum]);
+    ciai.resize(rpai[vNum]);
+    GL::parallelFor(0, vNum, [this, &g](int tid, long begin, long end){
+        for(long i = begin; i < end; i++){
+            std::copy(g.vertices[i]->outVid.begin(), g.vertices[i]->outVid.end(), ciao.begin() + rpao[i]);
+            std::copy(g.vertices[i]->inVid.begin(), g.vertices[i]->inVid.end(), ciai.begin() + rpai[i]);
         }
-    }
+    });
 
 }
 
 bool CSR::basicBfs(const int &startIdx, std::ofstream &fhandle){
     // Statistic information
-    int readBytes = 0;
-    int writeBytes = 0;
-    int readBursts = 0;
-    int writeBursts = 0;
+    long readBytes = 0;
+    long writeBytes = 0;
+    long readBursts = 0;
+    long writeBursts = 0;
 
     int level = 0;
-    std::vector<int> depth;
-    depth.resize(vNum);
-    std::fill(depth.begin(), depth.end(), -1);
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
 
     depth[startIdx] = 0;
     std::vector<int> frontier;
@@ -218,11 +301,10 @@ bool CSR::basicBfs(const int &startIdx, std::ofstream &fhandle){
         frontierDist.push_back(frontier.size());
         frontier = nextFrontier;
         level++;
+        checkDepthLimit(level);
     }
 
-    for(auto d : depth){
-        fhandle << d << std::endl;
-    }
+    dumpDepth(depth, fhandle);
 
     std::cout << "read/write bytes " << readBytes << " " << writeBytes << std::endl;
     std::cout << "read/write bursts " << readBursts << " " << writeBursts << std::endl;
@@ -240,15 +322,13 @@ bool CSR::basicBfs(const int &startIdx, std::ofstream &fhandle){
 // read based top-down bfs
 bool CSR::tdBfs(const int &startIdx, std::ofstream &fhandle){
 
-    int readBytes = 0;
-    int writeBytes = 0;
-    int readBursts = 0;
-    int writeBursts = 0;
+    long readBytes = 0;
+    long writeBytes = 0;
+    long readBursts = 0;
+    long writeBursts = 0;
 
     int level = 0;
-    std::vector<int> depth;
-    depth.resize(vNum);
-    std::fill(depth.begin(), depth.end(), -1);
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
     depth[startIdx] = 0;
 
     std::vector<int> frontier;
@@ -259,12 +339,10 @@ bool CSR::tdBfs(const int &startIdx, std::ofstream &fhandle){
         fhandle << "Level = " << level << std::endl;
         frontier.clear();
         readBursts += getBurstNum(vNum, 1);
-        for(int idx = 0; idx < vNum; idx++){
-            readBytes += 1; // read depth[idx]
-            if(depth[idx] == level){ 
-                frontier.push_back(idx);
-                fhandle << idx << " ";
-            }
+        readBytes += vNum; // read depth
+        DepthScan::extract(depth.data(), 0, vNum, level, frontier);
+        for(auto idx : frontier){
+            fhandle << idx << " ";
         }
         fhandle << std::endl << std::endl;
         for(auto vidx : frontier){
@@ -290,14 +368,13 @@ bool CSR::tdBfs(const int &startIdx, std::ofstream &fhandle){
 
         // update depth
         level++;
+        checkDepthLimit(level);
         eofBfs = frontier.empty();
 
     } while(!eofBfs); 
 
 
-    for(auto d : depth){
-        fhandle << d << std::endl;
-    }
+    dumpDepth(depth, fhandle);
 
     std::cout << "read/write bytes: " << readBytes << " " << writeBytes << std::endl;
     std::cout << "read/write bursts: " << readBursts << " " << writeBursts << std::endl;
@@ -315,15 +392,13 @@ bool CSR::tdBfs(const int &startIdx, std::ofstream &fhandle){
 // Read based bottom-up bfs
 bool CSR::buBfs(const int &startIdx, std::ofstream &fhandle){
 
-    int readBytes = 0;
-    int writeBytes = 0;
-    int readBursts = 0;
-    int writeBursts = 0;
+    long readBytes = 0;
+    long writeBytes = 0;
+    long readBursts = 0;
+    long writeBursts = 0;
 
     int level = 0;
-    std::vector<int> depth;
-    depth.resize(vNum);
-    std::fill(depth.begin(), depth.end(), -1);
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
     depth[startIdx] = 0;
 
     std::vector<int> frontier;
@@ -334,12 +409,8 @@ bool CSR::buBfs(const int &startIdx, std::ofstream &fhandle){
 
     do{
         readBursts += getBurstNum(vNum, 1);
-        for(int idx = 0; idx < vNum; idx++){
-            readBytes += 1; // read depth[idx]
-            if(depth[idx] == -1){
-                frontier.push_back(idx);
-            }
-        }
+        readBytes += vNum; // read depth
+        DepthScan::extract(depth.data(), 0, vNum, -1, frontier);
 
         // Traverse the frontier
         // When none of the frontier has a visited incoming neighboring, 
@@ -350,35 +421,28 @@ bool CSR::buBfs(const int &startIdx, std::ofstream &fhandle){
             readBursts += 1;
 
             readBursts += getBurstNum(rpai[vidx+1] - rpai[vidx], 4);
-            for(int cidx = rpai[vidx]; cidx < rpai[vidx+1]; cidx++){
-
-                readBytes += 4; // read ciai[cidx]
-                int inNgb = ciai[cidx];
-
-                readBytes += 1; // read depth[inNgb]
-                readBursts += 1;
-                if(depth[inNgb] == level){
-
-                    writeBytes += 1; // write depth[vidx]
-                    depth[vidx] = level + 1;
-                    writeBursts += 1;
-                    visitedNgbNum++;
-                    break;
-                }
+            int cidx = DepthScan::findParent(depth.data(), ciai.data(), rpai[vidx], rpai[vidx+1], level);
+            int checkedNum = std::min(cidx + 1, rpai[vidx+1]) - rpai[vidx];
+            readBytes += (4 + 1) * checkedNum; // read ciai[cidx] and depth[inNgb]
+            readBursts += checkedNum;
+            if(cidx < rpai[vidx+1]){
+                writeBytes += 1; // write depth[vidx]
+                depth[vidx] = level + 1;
+                writeBursts += 1;
+                visitedNgbNum++;
             }
         }
         frontierDist.push_back(frontier.size());
 
         // update depth
         level++;
+        checkDepthLimit(level);
         eofBfs = frontier.empty() || (visitedNgbNum == 0);
         frontier.clear();
 
     } while(!eofBfs); 
 
-    for(auto d : depth){
-        fhandle << d << std::endl;
-    }
+    dumpDepth(depth, fhandle);
 
     std::cout << "read/write bytes: " << readBytes << " " << writeBytes << std::endl;
     std::cout << "read/write bursts: " << readBursts << " " << writeBursts << std::endl;
@@ -395,20 +459,19 @@ bool CSR::buBfs(const int &startIdx, std::ofstream &fhandle){
 }
 
 bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
-    int readBytes = 0;
-    int writeBytes = 0;
-    int readBursts = 0;
-    int writeBursts = 0;
+    long readBytes = 0;
+    long writeBytes = 0;
+    long readBursts = 0;
+    long writeBursts = 0;
 
     int level = 0;
-    std::vector<int> depth;
-    depth.resize(vNum);
-    std::fill(depth.begin(), depth.end(), -1);
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
     depth[startIdx] = 0;
 
     std::vector<int> frontier;
     std::vector<size_t> frontierDist;
     std::vector<int> frontierHubVertex;
+    std::vector<int> levelVertices;
     std::vector<bool> bfsType;
     int totalHubVertexNum = getHubVertexNum();
     int visitedNgbNum = 0;
@@ -422,31 +485,16 @@ bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
 
         // get frontier and classfiy the frontier
         int frontierHubVertexNum = 0;
+        readBursts += getBurstNum(vNum, 1);
+        readBytes += vNum; // read depth
         if(topDown){
-            readBursts += getBurstNum(vNum, 1);
-            for(int idx = 0; idx < vNum; idx++){
-                readBytes += 1; // read depth[idx]
-                if(depth[idx] == level){ 
-                    frontier.push_back(idx);
-                    if(rpao[idx+1] - rpao[idx] >= hubVertexThreshold){
-                        frontierHubVertexNum++;
-                    }
-                }
-            }
+            DepthScan::extract(depth.data(), 0, vNum, level, frontier);
+            frontierHubVertexNum = getHubVertexNum(frontier);
         }
         else{
-            readBursts += getBurstNum(vNum, 1);
-            for(int idx = 0; idx < vNum; idx++){
-                readBytes += 1; // read depth[idx]
-                if(depth[idx] == -1){
-                    frontier.push_back(idx);
-                }
-                else if(depth[idx] == level){
-                    if(rpao[idx+1] - rpao[idx] >= hubVertexThreshold){
-                        frontierHubVertexNum++;
-                    }
-                }
-            }
+            levelVertices.clear();
+            DepthScan::extract(depth.data(), 0, vNum, -1, frontier, level, levelVertices);
+            frontierHubVertexNum = getHubVertexNum(levelVertices);
         }
 
         if(topDown){
@@ -476,22 +524,17 @@ bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
             for(auto vidx : frontier){
                 readBytes += 4 * 2; // read rpai[vidx+1] rpai[vidx] 
                 readBursts += 1;
-                int degree = rpai[vidx+1] - rpai[vidx];
 
                 readBursts += getBurstNum(rpai[vidx+1] - rpai[vidx], 4);
-                for(int cidx = rpai[vidx]; cidx < rpai[vidx+1]; cidx++){
-                    readBytes += 4; // read ciai[cidx]
-                    int inNgb = ciai[cidx];
-
-                    readBytes += 1; // read depth[inNgb]
-                    readBursts += 1;
-                    if(depth[inNgb] == level){
-                        writeBytes += 1; // write depth[vidx]
-                        writeBursts += 1;
-                        depth[vidx] = level + 1;
-                        visitedNgbNum++;
-                        break;
-                    }
+                int cidx = DepthScan::findParent(depth.data(), ciai.data(), rpai[vidx], rpai[vidx+1], level);
+                int checkedNum = std::min(cidx + 1, rpai[vidx+1]) - rpai[vidx];
+                readBytes += (4 + 1) * checkedNum; // read ciai[cidx] and depth[inNgb]
+                readBursts += checkedNum;
+                if(cidx < rpai[vidx+1]){
+                    writeBytes += 1; // write depth[vidx]
+                    writeBursts += 1;
+                    depth[vidx] = level + 1;
+                    visitedNgbNum++;
                 }
             }
         }
@@ -501,6 +544,7 @@ bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
 
         // update depth
         level++;
+        checkDepthLimit(level);
         eofBfs = frontier.empty() || (topDown == false && visitedNgbNum == 0);
         float hubPercentage = frontierHubVertexNum * 1.0 / totalHubVertexNum; 
         if(topDown && hubPercentage >= alpha){
@@ -513,9 +557,7 @@ bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
     } while(!eofBfs); 
 
 
-    for(auto d : depth){
-        fhandle << d << std::endl;
-    }
+    dumpDepth(depth, fhandle);
 
     std::cout << "read/write bytes: " << readBytes << " " << writeBytes << std::endl;
     std::cout << "read/write bursts: " << readBursts << " " << writeBursts << std::endl;
@@ -544,63 +586,207 @@ bool CSR::hybridBfs(const int &startIdx, std::ofstream &fhandle){
 }
 
 
+// Top-down step of the parallel bfs. The frontier is split evenly among 
+// the threads at first. A thread takes chunks from its own range and then 
+// steals chunks from the ranges of the other threads when it runs out of 
+// work, so the imbalance caused by the hub vertices is amortized. Multiple 
+// threads may reach the same vertex and only the winner of the CAS on its 
+// depth adds it to the next frontier.
+void CSR::parallelTopDown(
+        std::vector<int8_t> &depth, 
+        const std::vector<int> &frontier, 
+        std::vector<std::vector<int>> &nextFrontiers, 
+        int level)
+{
+    struct WorkRange{
+        std::atomic<long> cursor;
+        long end;
+    };
+
+    const long chunk = 64;
+    int threadNum = (int)nextFrontiers.size();
+    long len = ((long)frontier.size() + threadNum - 1) / threadNum;
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[threadNum]);
+    for(int tid = 0; tid < threadNum; tid++){
+        long begin = std::min((long)frontier.size(), tid * len);
+        ranges[tid].cursor.store(begin);
+        ranges[tid].end = std::min((long)frontier.size(), begin + len);
+    }
+
+    GL::parallelFor(0, threadNum, [&](int tid, long, long){
+        std::vector<int> &next = nextFrontiers[tid];
+        for(int i = 0; i < threadNum; i++){
+            WorkRange &range = ranges[(tid + i) % threadNum];
+            while(true){
+                long begin = range.cursor.fetch_add(chunk);
+                if(begin >= range.end) break;
+                long end = std::min(begin + chunk, range.end);
+                for(long k = begin; k < end; k++){
+                    int vidx = frontier[k];
+                    for(int cidx = rpao[vidx]; cidx < rpao[vidx+1]; cidx++){
+                        int outNgb = ciao[cidx];
+                        int8_t unvisited = -1;
+                        if(__atomic_load_n(&depth[outNgb], __ATOMIC_RELAXED) == -1 &&
+                           __atomic_compare_exchange_n(&depth[outNgb], &unvisited, (int8_t)(level + 1), 
+                               false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                            next.push_back(outNgb);
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Bottom-up step of the parallel bfs. Each thread checks a continuous 
+// range of the unvisited vertices and only updates the depth of its 
+// own vertices, so the next frontier is sorted after the concatenation.
+// The depth being updated is level + 1, so the concurrent parent checks 
+// of the other threads are not affected by the updates.
+void CSR::parallelBottomUp(
+        std::vector<int8_t> &depth, 
+        std::vector<std::vector<int>> &nextFrontiers, 
+        int level)
+{
+    GL::parallelFor(0, vNum, [&](int tid, long begin, long end){
+        std::vector<int> unvisited;
+        DepthScan::extract(depth.data(), (int)begin, (int)end, -1, unvisited);
+        std::vector<int> &next = nextFrontiers[tid];
+        for(auto vidx : unvisited){
+            int cidx = DepthScan::findParent(depth.data(), ciai.data(), rpai[vidx], rpai[vidx+1], level);
+            if(cidx < rpai[vidx+1]){
+                __atomic_store_n(&depth[vidx], (int8_t)(level + 1), __ATOMIC_RELAXED);
+                next.push_back(vidx);
+            }
+        }
+    });
+}
+
+// The direction is switched with the same alpha/beta policy as hybridBfs. 
+// The traverse is timed with wall clock and the depth dump is excluded.
+bool CSR::parallelBfs(const int &startIdx, std::ofstream &fhandle){
+    int threadNum = GL::getThreadNum();
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
+    depth[startIdx] = 0;
+
+    std::vector<int> frontier{startIdx};
+    std::vector<std::vector<int>> nextFrontiers(threadNum);
+    std::vector<size_t> frontierDist;
+    std::vector<bool> bfsType;
+    int totalHubVertexNum = getHubVertexNum();
+    bool topDown = true;
+    int level = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    while(!frontier.empty()){
+        int frontierHubVertexNum = 0;
+        for(auto vidx : frontier){
+            if(rpao[vidx+1] - rpao[vidx] >= hubVertexThreshold){
+                frontierHubVertexNum++;
+            }
+        }
+
+        for(auto &next : nextFrontiers){
+            next.clear();
+        }
+        bfsType.push_back(topDown);
+        if(topDown){
+            parallelTopDown(depth, frontier, nextFrontiers, level);
+        }
+        else{
+            parallelBottomUp(depth, nextFrontiers, level);
+        }
+
+        frontierDist.push_back(frontier.size());
+        frontier.clear();
+        for(auto &next : nextFrontiers){
+            frontier.insert(frontier.end(), next.begin(), next.end());
+        }
+
+        level++;
+        checkDepthLimit(level);
+        int visitedNgbNum = (int)frontier.size();
+        float hubPercentage = frontierHubVertexNum * 1.0 / totalHubVertexNum; 
+        if(topDown && hubPercentage >= alpha){
+            topDown = false;
+        }
+        else if(topDown == false && visitedNgbNum <= beta){
+            topDown = true;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double runtime = std::chrono::duration<double>(end - begin).count();
+
+    dumpDepth(depth, fhandle);
+    fhandle.close();
+
+    std::cout << "threads: " << threadNum << ", simd: " << DepthScan::getIsaName() << std::endl;
+    std::cout << "level type and frontier size: " << std::endl;
+    for(int i = 0; i < (int)frontierDist.size(); i++){
+        std::cout << (bfsType[i] ? "td " : "bu ") << frontierDist[i] << std::endl;
+    }
+    std::cout << "traverse time: " << runtime << " seconds." << std::endl;
+    std::cout << "BFS performance is " << eNum / runtime / 1e9;
+    std::cout << " billion traverse per second." << std::endl;
+
+    return true;
+}
+
 // This function further takes hub vertex cache into consideration.
+// The hub vertices of each level are loaded to the cache together with 
+// their depth, and the depth of a cached vertex is not read from memory. 
+// The cache keeps its content across the levels, while the capacity and 
+// the replacement policy are set with setCacheParam().
 bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
-    int readBytes = 0;
-    int writeBytes = 0;
-    int readBursts = 0;
-    int writeBursts = 0;
+    long readBytes = 0;
+    long writeBytes = 0;
+    long readBursts = 0;
+    long writeBursts = 0;
 
     int level = 0;
-    std::vector<int> depth;
-    depth.resize(vNum);
-    std::fill(depth.begin(), depth.end(), -1);
+    std::vector<int8_t> depth(vNum + DepthScan::padding, -1);
     depth[startIdx] = 0;
 
     std::vector<int> frontier;
+    std::vector<int> levelVertices;
     std::vector<size_t> frontierDist;
+    std::vector<long> levelHitNum;
+    std::vector<long> levelMissNum;
     int totalHubVertexNum = getHubVertexNum();
     int visitedNgbNum = 0;
     bool topDown = true;
     bool eofBfs;
 
-    std::vector<int> pingBuffer;
-    std::vector<int> pongBuffer;
+    int capacity = (cacheCapacity > 0) ? cacheCapacity : vNum;
+    HubCache cache(vNum, capacity, HubCache::getPolicy(cachePolicy));
 
     do{
         // Clean the frontier container
         frontier.clear();
 
-        // get frontier and classfiy the frontier
+        // get frontier and load the hub vertices of this level to the cache
         int frontierHubVertexNum = 0;
+        readBursts += getBurstNum(vNum, 1);
+        readBytes += vNum; // read depth
+        levelVertices.clear();
         if(topDown){
-            readBursts += getBurstNum(vNum, 1);
-            for(int idx = 0; idx < vNum; idx++){
-                readBytes += 1; // read depth[idx]
-                if(depth[idx] == level){ 
-                    frontier.push_back(idx);
-                    int degree = rpao[idx+1] - rpao[idx];
-                    if(degree >= cacheThreshold){
-                        pingBuffer.push_back(idx);
-                    }
-                }
-            }
+            DepthScan::extract(depth.data(), 0, vNum, level, levelVertices);
         }
         else{
-            readBursts += getBurstNum(vNum, 1);
-            for(int idx = 0; idx < vNum; idx++){
-                readBytes += 1; // read depth[idx]
-                if(depth[idx] == -1){
-                    frontier.push_back(idx);
-                }
-                else if(depth[idx] == level){
-                    int degree = rpao[idx+1] - rpao[idx];
-                    if(degree >= cacheThreshold){
-                        pingBuffer.push_back(idx);
-                    }
-                }
+            DepthScan::extract(depth.data(), 0, vNum, -1, frontier, level, levelVertices);
+        }
+        for(auto idx : levelVertices){
+            int degree = rpao[idx+1] - rpao[idx];
+            if(degree >= cacheThreshold){
+                cache.insert(idx, level, degree);
             }
         }
+        if(topDown){
+            frontier.swap(levelVertices);
+        }
+
+        long hitNum = cache.getHitNum();
+        long missNum = cache.getMissNum();
 
         // Traverse the frontier
         if(topDown){
@@ -611,9 +797,6 @@ bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
                 if(degree >= hubVertexThreshold){
                     frontierHubVertexNum++;
                 }
-                //if(degree >= cacheThreshold){
-                //    pingBuffer.push_back(vidx);
-                //}
 
                 readBursts += getBurstNum(rpao[vidx+1] - rpao[vidx], 4);
                 for(int cidx = rpao[vidx]; cidx < rpao[vidx+1]; cidx++){
@@ -621,7 +804,9 @@ bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
                     readBytes += 4; // read ciao[cidx]
                     int outNgb = ciao[cidx];
 
-                    if(isInBuffer(pingBuffer, outNgb)){
+                    // The cached vertices are visited already.
+                    int8_t cachedDepth;
+                    if(cache.lookup(outNgb, cachedDepth)){
                         continue;
                     }
                     else if(depth[outNgb] == -1){
@@ -651,31 +836,23 @@ bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
                     readBytes += 4; // read ciai[cidx]
                     int inNgb = ciai[cidx];
 
-                    if(isInBuffer(pingBuffer, inNgb)){
-                        writeBytes += 1; // write depth
-                        writeBursts += 1;
-                        depth[vidx] = level + 1;
-                        if(degree >= hubVertexThreshold){
-                            frontierHubVertexNum++;
-                        }
-                        //if(degree >= cacheThreshold){
-                        //    pongBuffer.push_back(vidx);
-                        //}
-                        visitedNgbNum++;
-                        break;
+                    // A cached vertex of an earlier level is not a parent.
+                    int8_t cachedDepth;
+                    bool hit = cache.lookup(inNgb, cachedDepth);
+                    if(hit && cachedDepth != level){
+                        continue;
                     }
-                    else if(depth[inNgb] == level){
-                        readBytes += 1; // read depth[inNgb]
+                    else if(hit || depth[inNgb] == level){
+                        if(!hit){
+                            readBytes += 1; // read depth[inNgb]
+                            readBursts += 1;
+                        }
                         writeBytes += 1; // write depth[vidx]
                         writeBursts += 1;
-                        readBursts += 1;
                         depth[vidx] = level + 1;
                         if(degree >= hubVertexThreshold){
                             frontierHubVertexNum++;
                         }
-                        //if(degree >= cacheThreshold){
-                        //    pongBuffer.push_back(vidx);
-                        //}
                         visitedNgbNum++;
                         break;
                     }
@@ -688,9 +865,12 @@ bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
         }
 
         frontierDist.push_back(frontier.size());
+        levelHitNum.push_back(cache.getHitNum() - hitNum);
+        levelMissNum.push_back(cache.getMissNum() - missNum);
 
         // update depth
         level++;
+        checkDepthLimit(level);
         eofBfs = frontier.empty() || (topDown == false && visitedNgbNum == 0);
         float hubPercentage = frontierHubVertexNum * 1.0 / totalHubVertexNum; 
         if(topDown && hubPercentage >= alpha){
@@ -698,33 +878,26 @@ bool CSR::cacheHybridBfs(const int &startIdx, std::ofstream &fhandle){
         }
         else if(topDown == false && visitedNgbNum <= beta){
             topDown = true;
-            //pingBuffer = pongBuffer;
-            //pongBuffer.clear();
-        }
-        else if(topDown == false){
-            //pingBuffer = pongBuffer;
-            //pongBuffer.clear();
         }
-        pingBuffer.clear();
-
 
     } while(!eofBfs); 
 
 
-    for(auto d : depth){
-        fhandle << d << std::endl;
-    }
+    dumpDepth(depth, fhandle);
 
     std::cout << "read/write bytes: " << readBytes << " " << writeBytes << std::endl;
     std::cout << "read/write bursts: " << readBursts << " " << writeBursts << std::endl;
 
-    //fhandle << "frontier distribution: " << std::endl;
-    //for(auto num : frontierDist){
-    //    fhandle << num << " ";
-    //}
-    //fhandle << std::endl;
+    std::cout << "hub cache " << capacity << " entries, " << cachePolicy << std::endl;
+    std::cout << "level hit miss hit-rate" << std::endl;
+    for(int i = 0; i < (int)levelHitNum.size(); i++){
+        long accessNum = levelHitNum[i] + levelMissNum[i];
+        std::cout << i << " " << levelHitNum[i] << " " << levelMissNum[i] << " ";
+        std::cout << (accessNum == 0 ? 0 : levelHitNum[i] * 1.0 / accessNum) << std::endl;
+    }
     fhandle.close();
 
+    return true;
 }
 
 // Basically, we want to know the vertex degree distribution 
@@ -763,18 +936,6 @@ void CSR::degreeAnalysis(){
 
 }
 
-int CSR::getPotentialCacheSaving(){
-    int totalSaving = 0;
-    for(int idx = 0; idx < vNum; idx++){
-        int degree = rpai[idx+1] - rpai[idx];
-        if(degree >= cacheThreshold){
-            totalSaving += degree;
-        }
-    }
-
-    return totalSaving;
-}
-
 int CSR::getHubVertexNum(){
     int maxDeg = 0;
     int hubVertexNum = 0;
@@ -793,15 +954,20 @@ int CSR::getHubVertexNum(){
     return hubVertexNum;
 }
 
-bool CSR::isInBuffer(
-        const std::vector<int> &buffer, 
-        const int &idx)
-{
-    if(std::find(buffer.begin(), buffer.end(), idx) != buffer.end()){
-        return true;
+int CSR::getHubVertexNum(const std::vector<int> &vertices){
+    int hubVertexNum = 0;
+    for(auto idx : vertices){
+        if(rpao[idx+1] - rpao[idx] >= hubVertexThreshold){
+            hubVertexNum++;
+        }
     }
-    else{
-        return false;
+    return hubVertexNum;
+}
+
+// Only the first vNum depths are valid while the rest is padding.
+void CSR::dumpDepth(const std::vector<int8_t> &depth, std::ofstream &fhandle){
+    for(int idx = 0; idx < vNum; idx++){
+        fhandle << (int)depth[idx] << std::endl;
     }
 }
 
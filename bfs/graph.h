@@ -10,12 +10,29 @@
 #include <cmath>
 #include <map>
 #include <algorithm>
+#include <functional>
+#include "simd.h"
+#include "hubcache.h"
 
 #define HERE do {std::cout << "File: " << __FILE__ << " Line: " << __LINE__ << std::endl;} while(0)
 
+// bfs/ is a standalone program built without src/, so the host thread 
+// helpers are kept here as a copy of GL::getHostThreadNum and 
+// GL::parallelFor in src/common.h. A change to one should go to both.
 class GL{
     public:
         static int burstlen;
+
+        // # of host threads, and all the cores are used when it is not positive.
+        static int threadNum;
+        static int getThreadNum();
+
+        // Split [begin, end) into a continuous range per thread, and 
+        // func(tid, rangeBegin, rangeEnd) is invoked in each thread.
+        static void parallelFor(
+                long begin, 
+                long end, 
+                const std::function<void(int, long, long)> &func);
 };
 
 class Vertex {
@@ -78,6 +95,8 @@ class CSR{
                 int _cacheThreshold, 
                 int _bucketNum);
 
+        void setCacheParam(int _cacheCapacity, const std::string &_cachePolicy);
+
         // hybrid read based bfs with hub vertex cache
         bool cacheHybridBfs(const int &startIdx, std::ofstream &fhandle); 
 
@@ -93,7 +112,9 @@ class CSR{
         // read based bottom-up bfs
         bool buBfs(const int &startIdx, std::ofstream &fhandle); 
 
-        int getPotentialCacheSaving();
+        // multithreaded hybrid bfs, switching the direction like hybridBfs
+        bool parallelBfs(const int &startIdx, std::ofstream &fhandle); 
+
         void degreeAnalysis();
         ~CSR();
 
@@ -105,11 +126,21 @@ class CSR{
         int hubVertexThreshold;
         int cacheThreshold;
         int bucketNum;
+        int cacheCapacity;
+        std::string cachePolicy;
 
-        bool isInBuffer(
-                const std::vector<int> &buffer, 
-                const int &idx);
         int getHubVertexNum();
+        int getHubVertexNum(const std::vector<int> &vertices);
+        void dumpDepth(const std::vector<int8_t> &depth, std::ofstream &fhandle);
+        void parallelTopDown(
+                std::vector<int8_t> &depth, 
+                const std::vector<int> &frontier, 
+                std::vector<std::vector<int>> &nextFrontiers, 
+                int level);
+        void parallelBottomUp(
+                std::vector<int8_t> &depth, 
+                std::vector<std::vector<int>> &nextFrontiers, 
+                int level);
         int getBurstNum(int num, int size);
 };
 
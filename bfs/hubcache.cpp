@@ -0,0 +1,125 @@
+#include "graph.h"
+
+HubCache::HubCache(int vNum, int _capacity, Policy _policy){
+    capacity = _capacity;
+    policy = _policy;
+    hitNum = 0;
+    missNum = 0;
+    head = -1;
+    tail = -1;
+
+    slotOf.resize(vNum, -1);
+    slotVertex.resize(capacity, -1);
+    slotDepth.resize(capacity, -1);
+    slotDegree.resize(capacity, 0);
+    prev.resize(capacity, -1);
+    next.resize(capacity, -1);
+    for(int slot = capacity - 1; slot >= 0; slot--){
+        freeSlots.push_back(slot);
+    }
+}
+
+HubCache::Policy HubCache::getPolicy(const std::string &name){
+    if(name == "fifo"){
+        return Policy::FIFO;
+    }
+    else if(name == "lru"){
+        return Policy::LRU;
+    }
+    else if(name == "degree"){
+        return Policy::DEGREE;
+    }
+
+    HERE;
+    std::cout << "Unknown cache replacement policy " << name << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+bool HubCache::lookup(int vidx, int8_t &depth){
+    int slot = slotOf[vidx];
+    if(slot == -1){
+        missNum++;
+        return false;
+    }
+
+    hitNum++;
+    depth = slotDepth[slot];
+    if(policy == Policy::LRU){
+        unlink(slot);
+        append(slot);
+    }
+    return true;
+}
+
+void HubCache::insert(int vidx, int8_t depth, int degree){
+    if(capacity == 0){
+        return;
+    }
+
+    int slot = slotOf[vidx];
+    if(slot != -1){
+        slotDepth[slot] = depth;
+        if(policy == Policy::LRU){
+            unlink(slot);
+            append(slot);
+        }
+        return;
+    }
+
+    if(freeSlots.empty()){
+        int victim = getVictim();
+        if(policy == Policy::DEGREE && slotDegree[victim] >= degree){
+            return;
+        }
+        evict(victim);
+    }
+
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+    slotOf[vidx] = slot;
+    slotVertex[slot] = vidx;
+    slotDepth[slot] = depth;
+    slotDegree[slot] = degree;
+    if(policy == Policy::DEGREE){
+        degreeOrder.insert(std::make_pair(degree, slot));
+    }
+    else{
+        append(slot);
+    }
+}
+
+int HubCache::getVictim(){
+    if(policy == Policy::DEGREE){
+        return degreeOrder.begin()->second;
+    }
+    return head;
+}
+
+void HubCache::evict(int slot){
+    if(policy == Policy::DEGREE){
+        degreeOrder.erase(std::make_pair(slotDegree[slot], slot));
+    }
+    else{
+        unlink(slot);
+    }
+    slotOf[slotVertex[slot]] = -1;
+    slotVertex[slot] = -1;
+    freeSlots.push_back(slot);
+}
+
+void HubCache::unlink(int slot){
+    if(prev[slot] != -1) next[prev[slot]] = next[slot];
+    else head = next[slot];
+    if(next[slot] != -1) prev[next[slot]] = prev[slot];
+    else tail = prev[slot];
+    prev[slot] = -1;
+    next[slot] = -1;
+}
+
+void HubCache::append(int slot){
+    prev[slot] = tail;
+    next[slot] = -1;
+    if(tail != -1) next[tail] = slot;
+    else head = slot;
+    tail = slot;
+}
@@ -0,0 +1,56 @@
+#ifndef __HUB_CACHE_H__
+#define __HUB_CACHE_H__
+
+#include <vector>
+#include <set>
+#include <string>
+#include <cstdint>
+
+// On-chip cache of the depth of the hub vertices. Membership is checked in
+// constant time with a direct vertex to slot table, and the cached vertices
+// are replaced with one of the following policies when the cache is full.
+//   fifo    the earliest inserted vertex is evicted
+//   lru     the least recently inserted or hit vertex is evicted
+//   degree  the vertex with the smallest degree is evicted, and a vertex
+//           with a smaller degree than all the cached ones is not inserted
+class HubCache{
+    public:
+        enum class Policy {FIFO, LRU, DEGREE};
+
+        HubCache(int vNum, int _capacity, Policy _policy);
+        static Policy getPolicy(const std::string &name);
+
+        // It returns true with the cached depth when vidx is in the cache.
+        bool lookup(int vidx, int8_t &depth);
+        void insert(int vidx, int8_t depth, int degree);
+        long getHitNum() const { return hitNum; }
+        long getMissNum() const { return missNum; }
+
+    private:
+        int capacity;
+        Policy policy;
+        long hitNum;
+        long missNum;
+
+        std::vector<int> slotOf;       // vertex -> slot, -1 when it is not cached
+        std::vector<int> slotVertex;
+        std::vector<int8_t> slotDepth;
+        std::vector<int> slotDegree;
+        std::vector<int> freeSlots;
+
+        // Slots in the order of replacement for fifo and lru, from head to tail.
+        std::vector<int> prev;
+        std::vector<int> next;
+        int head;
+        int tail;
+
+        // Slots ordered by the vertex degree for the degree policy.
+        std::set<std::pair<int, int>> degreeOrder;
+
+        void unlink(int slot);
+        void append(int slot);
+        int getVictim();
+        void evict(int slot);
+};
+
+#endif
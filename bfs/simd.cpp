@@ -0,0 +1,268 @@
+#include "simd.h"
+#include <immintrin.h>
+
+DepthScan::Isa DepthScan::isa = DepthScan::detectIsa();
+
+DepthScan::Isa DepthScan::detectIsa(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")){
+        return Isa::AVX512;
+    }
+    else if(__builtin_cpu_supports("avx2")){
+        return Isa::AVX2;
+    }
+    return Isa::SCALAR;
+}
+
+const char* DepthScan::getIsaName(){
+    switch(isa){
+        case Isa::AVX512: return "avx512";
+        case Isa::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+static void extractScalar(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val,
+        std::vector<int> &out)
+{
+    for(int idx = begin; idx < end; idx++){
+        if(depth[idx] == val){
+            out.push_back(idx);
+        }
+    }
+}
+
+static void extractScalar(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val0,
+        std::vector<int> &out0,
+        int8_t val1,
+        std::vector<int> &out1)
+{
+    for(int idx = begin; idx < end; idx++){
+        if(depth[idx] == val0){
+            out0.push_back(idx);
+        }
+        else if(depth[idx] == val1){
+            out1.push_back(idx);
+        }
+    }
+}
+
+static void appendMaskAvx2(unsigned mask, int idx, std::vector<int> &out){
+    while(mask != 0){
+        out.push_back(idx + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+}
+
+// 32 depths are compared at a time, and the rare matches are
+// appended by walking through the bits of the mask.
+__attribute__((target("avx2")))
+static void extractAvx2(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val,
+        std::vector<int> &out)
+{
+    const __m256i target = _mm256_set1_epi8(val);
+    int idx = begin;
+    for(; idx + 32 <= end; idx += 32){
+        __m256i d = _mm256_loadu_si256((const __m256i*)(depth + idx));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, target));
+        appendMaskAvx2(mask, idx, out);
+    }
+    extractScalar(depth, idx, end, val, out);
+}
+
+__attribute__((target("avx2")))
+static void extractAvx2(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val0,
+        std::vector<int> &out0,
+        int8_t val1,
+        std::vector<int> &out1)
+{
+    const __m256i target0 = _mm256_set1_epi8(val0);
+    const __m256i target1 = _mm256_set1_epi8(val1);
+    int idx = begin;
+    for(; idx + 32 <= end; idx += 32){
+        __m256i d = _mm256_loadu_si256((const __m256i*)(depth + idx));
+        appendMaskAvx2((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, target0)), idx, out0);
+        appendMaskAvx2((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, target1)), idx, out1);
+    }
+    extractScalar(depth, idx, end, val0, out0, val1, out1);
+}
+
+// The indices of each 16 depths of the 64 selected by mask are
+// compress-stored to the output directly.
+__attribute__((target("avx512f,avx512bw")))
+static void appendMaskAvx512(__mmask64 mask, int idx, std::vector<int> &out){
+    if(mask == 0) return;
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t num = out.size();
+    out.resize(num + 64);
+    for(int q = 0; q < 4; q++){
+        __mmask16 m = (__mmask16)(mask >> (16 * q));
+        if(m == 0) continue;
+        __m512i vidx = _mm512_add_epi32(_mm512_set1_epi32(idx + 16 * q), iota);
+        _mm512_mask_compressstoreu_epi32(&out[num], m, vidx);
+        num += __builtin_popcount(m);
+    }
+    out.resize(num);
+}
+
+// 64 depths are compared at a time.
+__attribute__((target("avx512f,avx512bw")))
+static void extractAvx512(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val,
+        std::vector<int> &out)
+{
+    const __m512i target = _mm512_set1_epi8(val);
+    int idx = begin;
+    for(; idx + 64 <= end; idx += 64){
+        __m512i d = _mm512_loadu_si512((const void*)(depth + idx));
+        appendMaskAvx512(_mm512_cmpeq_epi8_mask(d, target), idx, out);
+    }
+    extractScalar(depth, idx, end, val, out);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void extractAvx512(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val0,
+        std::vector<int> &out0,
+        int8_t val1,
+        std::vector<int> &out1)
+{
+    const __m512i target0 = _mm512_set1_epi8(val0);
+    const __m512i target1 = _mm512_set1_epi8(val1);
+    int idx = begin;
+    for(; idx + 64 <= end; idx += 64){
+        __m512i d = _mm512_loadu_si512((const void*)(depth + idx));
+        appendMaskAvx512(_mm512_cmpeq_epi8_mask(d, target0), idx, out0);
+        appendMaskAvx512(_mm512_cmpeq_epi8_mask(d, target1), idx, out1);
+    }
+    extractScalar(depth, idx, end, val0, out0, val1, out1);
+}
+
+void DepthScan::extract(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val,
+        std::vector<int> &out)
+{
+    switch(isa){
+        case Isa::AVX512: extractAvx512(depth, begin, end, val, out); break;
+        case Isa::AVX2: extractAvx2(depth, begin, end, val, out); break;
+        default: extractScalar(depth, begin, end, val, out); break;
+    }
+}
+
+void DepthScan::extract(
+        const int8_t* depth,
+        int begin,
+        int end,
+        int8_t val0,
+        std::vector<int> &out0,
+        int8_t val1,
+        std::vector<int> &out1)
+{
+    switch(isa){
+        case Isa::AVX512: extractAvx512(depth, begin, end, val0, out0, val1, out1); break;
+        case Isa::AVX2: extractAvx2(depth, begin, end, val0, out0, val1, out1); break;
+        default: extractScalar(depth, begin, end, val0, out0, val1, out1); break;
+    }
+}
+
+static int findParentScalar(
+        const int8_t* depth,
+        const int* ciai,
+        int begin,
+        int end,
+        int8_t level)
+{
+    for(int cidx = begin; cidx < end; cidx++){
+        if(depth[ciai[cidx]] == level){
+            return cidx;
+        }
+    }
+    return end;
+}
+
+// The depths of 8 neighbours are gathered as 32-bit words at byte
+// offsets and only the lowest byte is compared.
+__attribute__((target("avx2")))
+static int findParentAvx2(
+        const int8_t* depth,
+        const int* ciai,
+        int begin,
+        int end,
+        int8_t level)
+{
+    const __m256i target = _mm256_set1_epi32((uint8_t)level);
+    const __m256i lowByte = _mm256_set1_epi32(0xFF);
+    int cidx = begin;
+    for(; cidx + 8 <= end; cidx += 8){
+        __m256i vidx = _mm256_loadu_si256((const __m256i*)(ciai + cidx));
+        __m256i d = _mm256_i32gather_epi32((const int*)depth, vidx, 1);
+        d = _mm256_and_si256(d, lowByte);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, target)));
+        if(mask != 0){
+            return cidx + __builtin_ctz(mask);
+        }
+    }
+    return findParentScalar(depth, ciai, cidx, end, level);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int findParentAvx512(
+        const int8_t* depth,
+        const int* ciai,
+        int begin,
+        int end,
+        int8_t level)
+{
+    const __m512i target = _mm512_set1_epi32((uint8_t)level);
+    const __m512i lowByte = _mm512_set1_epi32(0xFF);
+    for(int cidx = begin; cidx < end; cidx += 16){
+        __mmask16 valid = (end - cidx >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (end - cidx)) - 1);
+        __m512i vidx = _mm512_maskz_loadu_epi32(valid, ciai + cidx);
+        __m512i d = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), valid, vidx, depth, 1);
+        d = _mm512_and_si512(d, lowByte);
+        __mmask16 mask = _mm512_mask_cmpeq_epi32_mask(valid, d, target);
+        if(mask != 0){
+            return cidx + __builtin_ctz(mask);
+        }
+    }
+    return end;
+}
+
+int DepthScan::findParent(
+        const int8_t* depth,
+        const int* ciai,
+        int begin,
+        int end,
+        int8_t level)
+{
+    switch(isa){
+        case Isa::AVX512: return findParentAvx512(depth, ciai, begin, end, level);
+        case Isa::AVX2: return findParentAvx2(depth, ciai, begin, end, level);
+        default: return findParentScalar(depth, ciai, begin, end, level);
+    }
+}
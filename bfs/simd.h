@@ -0,0 +1,51 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <vector>
+#include <cstdint>
+
+// Vectorized kernels on the int8 depth array. AVX-512 or AVX2 is selected
+// at runtime according to the cpu, and the scalar code is used otherwise.
+// The parent check gathers 4 bytes per neighbour, so the depth array must
+// be allocated with padding extra bytes after the last vertex.
+class DepthScan{
+    public:
+        static const int padding = 4;
+
+        // Append the indices in [begin, end) with depth equal to val to out.
+        static void extract(
+                const int8_t* depth,
+                int begin,
+                int end,
+                int8_t val,
+                std::vector<int> &out);
+
+        // Append the indices in [begin, end) with depth equal to val0 to
+        // out0 and those with depth equal to val1 to out1 in a single pass.
+        static void extract(
+                const int8_t* depth,
+                int begin,
+                int end,
+                int8_t val0,
+                std::vector<int> &out0,
+                int8_t val1,
+                std::vector<int> &out1);
+
+        // Return the first position in [begin, end) whose neighbour
+        // ciai[pos] has depth equal to level, or end if there is none.
+        static int findParent(
+                const int8_t* depth,
+                const int* ciai,
+                int begin,
+                int end,
+                int8_t level);
+
+        static const char* getIsaName();
+
+    private:
+        enum class Isa {SCALAR, AVX2, AVX512};
+        static Isa isa;
+        static Isa detectIsa();
+};
+
+#endif
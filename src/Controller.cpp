@@ -48,6 +48,7 @@ bool Controller<SALP>::is_ready(list<Request>::iterator req){
 template <>
 void Controller<ALDRAM>::update_temp(ALDRAM::Temp current_temperature){
     channel->spec->aldram_timing(current_temperature);
+    channel->load_timing();
 }
 
 
@@ -71,9 +72,11 @@ void Controller<TLDRAM>::tick(){
             pending.pop_front();
         }
     }
+    serve_pending_writes();
 
     /*** 2. Should we schedule refreshes? ***/
     refresh->tick_ref();
+    energy->tick();
 
     /*** 3. Should we schedule writes? ***/
     if (!write_mode) {
@@ -157,7 +160,10 @@ void Controller<TLDRAM>::tick(){
     }
     if (req->type == Request::Type::WRITE) {
         channel->update_serving_requests(req->addr_vec.data(), -1, clk);
-        req->callback(*req);
+        if (write_callback) {
+            req->depart = clk + get_write_latency();
+            pending_writes.push_back(*req);
+        }
     }
 
     // remove request from queue
@@ -11,6 +11,7 @@
 
 #include "Config.h"
 #include "DRAM.h"
+#include "Energy.h"
 #include "Refresh.h"
 #include "Request.h"
 #include "Scheduler.h"
@@ -71,6 +72,7 @@ public:
     RowPolicy<T>* rowpolicy;  // determines the row-policy (e.g., closed-row vs. open-row)
     RowTable<T>* rowtable;  // tracks metadata about rows (e.g., which are open and for how long)
     Refresh<T>* refresh;
+    Energy<T>* energy;
 
     struct Queue {
         list<Request> q;
@@ -84,6 +86,12 @@ public:
 
     deque<Request> pending;  // read requests that are about to receive data from DRAM
     bool write_mode = false;  // whether write requests should be prioritized over reads
+
+    // The callback of a write request is invoked when its data is written,
+    // i.e. the write latency after the WR command. Writes are complete once
+    // they are sent to the controller otherwise, and they have no callback.
+    bool write_callback = false;
+    deque<Request> pending_writes;  // write requests of which the data is being written
     //long refreshed = 0;  // last time refresh requests were generated
 
     /* Command trace for DRAMPower 3.1 */
@@ -100,6 +108,7 @@ public:
         rowpolicy(new RowPolicy<T>(this)),
         rowtable(new RowTable<T>(this)),
         refresh(new Refresh<T>(this)),
+        energy(new Energy<T>(this, configs)),
         cmd_trace_files(channel->children.size())
     {
         record_cmd_trace = configs.record_cmd_trace();
@@ -270,6 +279,7 @@ public:
         delete rowtable;
         delete channel;
         delete refresh;
+        delete energy;
         for (auto& file : cmd_trace_files)
             file.close();
         cmd_trace_files.clear();
@@ -333,9 +343,11 @@ public:
                 pending.pop_front();
             }
         }
+        serve_pending_writes();
 
         /*** 2. Refresh scheduler ***/
         refresh->tick_ref();
+        energy->tick();
 
         /*** 3. Should we schedule writes? ***/
         if (!write_mode) {
@@ -415,12 +427,54 @@ public:
 
         if (req->type == Request::Type::WRITE) {
             channel->update_serving_requests(req->addr_vec.data(), -1, clk);
+            if (write_callback) {
+                req->depart = clk + get_write_latency();
+                pending_writes.push_back(*req);
+            }
         }
 
         // remove request from queue
         queue->q.erase(req);
     }
 
+    int get_write_latency()
+    {
+        return channel->spec->speed_entry.nCWL + channel->spec->speed_entry.nBL;
+    }
+
+    void serve_pending_writes()
+    {
+        if (pending_writes.size() && pending_writes[0].depart <= clk) {
+            pending_writes[0].callback(pending_writes[0]);
+            pending_writes.pop_front();
+        }
+    }
+
+    // # of the following cycles in which tick() only advances the clock and
+    // the background energy: no request is queued or in flight, no refresh
+    // is due, and the row policy doesn't close the open rows by itself.
+    long get_idle_cycles()
+    {
+        if (readq.size() || writeq.size() || otherq.size() || pending.size() || pending_writes.size() || is_active())
+            return 0;
+        if (rowpolicy->type != RowPolicy<T>::Type::Opened && rowtable->table.size())
+            return 0;
+        return refresh->get_idle_cycles();
+    }
+
+    // Same as cycles calls of tick() when they are idle. The write mode is
+    // entered on the first idle tick as the read queue is empty.
+    void skip_idle(long cycles)
+    {
+        if (cycles <= 0)
+            return;
+        clk += cycles;
+        refresh->skip_idle(cycles);
+        for (long i = 0; i < cycles; i++)
+            energy->tick();
+        write_mode = true;
+    }
+
     bool is_ready(list<Request>::iterator req)
     {
         typename T::Command cmd = get_first_cmd(req);
@@ -492,7 +546,10 @@ private:
     {
         assert(is_ready(cmd, addr_vec));
         channel->update(cmd, addr_vec.data(), clk);
+        int open_rows = rowtable->table.size();
         rowtable->update(cmd, addr_vec, clk);
+        int opened = rowtable->table.size() - open_rows;
+        energy->update(cmd, addr_vec[int(T::Level::Rank)], max(opened, 0), max(-opened, 0));
         if (record_cmd_trace){
             // select rank
             auto& file = cmd_trace_files[addr_vec[1]];
@@ -53,6 +53,9 @@ public:
     // Insert a node as one of my child nodes
     void insert(DRAM<T>* child);
 
+    // Reload the timing parameters of the spec after they are changed (e.g., ALDRAM)
+    void load_timing();
+
     // Decode a command into its "prerequisite" command (if any is needed)
     typename T::Command decode(typename T::Command cmd, const int* addr);
 
@@ -92,11 +95,10 @@ public:
 private:
     // Constructor
     DRAM(){}
+    DRAM(T* spec, typename T::Level level, DRAM<T>* parent, int id);
 
     // Timing
     long cur_clk = 0;
-    long next[int(T::Command::MAX)]; // the earliest time in the future when a command could be ready
-    deque<long> prev[int(T::Command::MAX)]; // the most recent history of when commands were issued
 
     // Lookup table for which commands must be preceded by which other commands (i.e., "prerequisite")
     // E.g., a read command to a closed bank must be preceded by an activate command
@@ -112,13 +114,35 @@ private:
     // E.g., an activate command to a closed bank opens both the bank and the row
     function<void(DRAM<T>*, int)>* lambda;
 
-    // Lookup table for timing parameters
-    // E.g., activate->precharge: tRAS@bank, activate->activate: tRC@bank
-    vector<typename T::TimingEntry>* timing;
+    // Flattened timing state of the tree, kept by the root only. The nodes
+    // are numbered level by level and the children of a node are adjacent,
+    // so the node on the path of an address is one indexed load per level.
+    // The state of the nodes (e.g., Opened, Closed) stays in the node
+    // objects, since the lambdas of the spec work on them.
+    struct FlatTiming {
+        int cmd;
+        int dist;
+        int val;
+        bool refresh; // a refresh that opens the node (refresh statistics)
+    };
+    vector<DRAM<T>*> nodes;
+    vector<int> node_level;
+    vector<int> first_child;
+    vector<int> child_num;
+    vector<long> next; // [node][cmd] the earliest time in the future when a command could be ready
+    vector<long> prev; // the most recent history of when commands were issued, a ring per [node][cmd]
+    vector<int> prev_base; // [node][cmd]
+    vector<int> prev_head; // [node][cmd] slot of the most recent command
+    vector<int> prev_len;  // [level][cmd]
+    vector<FlatTiming> timing_entry;
+    vector<int> target_begin, sibling_begin, timing_end; // [level][cmd]
 
     // Helper Functions
+    void flatten();
     void update_state(typename T::Command cmd, const int* addr);
     void update_timing(typename T::Command cmd, const int* addr, long clk);
+    void update_target(int node, int cmd, long clk);
+    void update_sibling(int node, int cmd, long clk);
 }; /* class DRAM */
 
 
@@ -188,7 +212,14 @@ void DRAM<T>::finish(long dram_cycles) {
 // Constructor
 template <typename T>
 DRAM<T>::DRAM(T* spec, typename T::Level level) :
-    spec(spec), level(level), id(0), parent(NULL)
+    DRAM(spec, level, NULL, 0)
+{
+    flatten();
+}
+
+template <typename T>
+DRAM<T>::DRAM(T* spec, typename T::Level level, DRAM<T>* parent, int id) :
+    spec(spec), level(level), id(id), parent(parent)
 {
 
     state = spec->start[(int)level];
@@ -196,17 +227,6 @@ DRAM<T>::DRAM(T* spec, typename T::Level level) :
     rowhit = spec->rowhit[int(level)];
     rowopen = spec->rowopen[int(level)];
     lambda = spec->lambda[int(level)];
-    timing = spec->timing[int(level)];
-
-    fill_n(next, int(T::Command::MAX), -1); // initialize future
-    for (int cmd = 0; cmd < int(T::Command::MAX); cmd++) {
-        int dist = 0;
-        for (auto& t : timing[cmd])
-            dist = max(dist, t.dist);
-
-        if (dist)
-            prev[cmd].resize(dist, -1); // initialize history
-    }
 
     // try to recursively construct my children
     int child_level = int(level) + 1;
@@ -218,12 +238,8 @@ DRAM<T>::DRAM(T* spec, typename T::Level level) :
         return; // stop recursion: the number of children is unspecified
 
     // recursively construct my children
-    for (int i = 0; i < child_max; i++) {
-        DRAM<T>* child = new DRAM<T>(spec, typename T::Level(child_level));
-        child->parent = this;
-        child->id = i;
-        children.push_back(child);
-    }
+    for (int i = 0; i < child_max; i++)
+        children.push_back(new DRAM<T>(spec, typename T::Level(child_level), this, i));
 
 }
 
@@ -234,6 +250,78 @@ DRAM<T>::~DRAM()
         delete child;
 }
 
+// Number the nodes of the tree level by level and lay out their timing state
+template <typename T>
+void DRAM<T>::flatten()
+{
+    const int cmd_max = int(T::Command::MAX);
+
+    nodes.assign(1, this);
+    node_level.assign(1, int(level));
+    first_child.clear();
+    child_num.clear();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        first_child.push_back(nodes.size());
+        child_num.push_back(nodes[i]->children.size());
+        for (auto child : nodes[i]->children) {
+            nodes.push_back(child);
+            node_level.push_back(int(child->level));
+        }
+    }
+
+    load_timing();
+
+    next.assign(nodes.size() * cmd_max, -1); // initialize future
+    prev_base.resize(nodes.size() * cmd_max);
+    prev_head.assign(nodes.size() * cmd_max, 0);
+    int prev_size = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (int cmd = 0; cmd < cmd_max; cmd++) {
+            prev_base[i * cmd_max + cmd] = prev_size;
+            prev_size += prev_len[node_level[i] * cmd_max + cmd];
+        }
+    }
+    prev.assign(prev_size, -1); // initialize history
+}
+
+// Split the timing parameters of each level and command (e.g., activate->precharge:
+// tRAS@bank, activate->activate: tRC@bank) into the ones of the target node and
+// the ones of its siblings
+template <typename T>
+void DRAM<T>::load_timing()
+{
+    const int cmd_max = int(T::Command::MAX);
+    const int level_max = int(T::Level::MAX);
+
+    timing_entry.clear();
+    target_begin.resize(level_max * cmd_max);
+    sibling_begin.resize(level_max * cmd_max);
+    timing_end.resize(level_max * cmd_max);
+    prev_len.assign(level_max * cmd_max, 0);
+    for (int l = 0; l < level_max; l++) {
+        for (int cmd = 0; cmd < cmd_max; cmd++) {
+            int i = l * cmd_max + cmd;
+            auto& entries = spec->timing[l][cmd];
+            target_begin[i] = timing_entry.size();
+            for (auto& t : entries) {
+                prev_len[i] = max(prev_len[i], t.dist);
+                if (t.sibling)
+                    continue;
+                bool refresh = spec->is_refreshing(typename T::Command(cmd)) && spec->is_opening(t.cmd);
+                timing_entry.push_back({int(t.cmd), t.dist, t.val, refresh});
+            }
+            sibling_begin[i] = timing_entry.size();
+            for (auto& t : entries) {
+                if (!t.sibling)
+                    continue;
+                assert (t.dist == 1);
+                timing_entry.push_back({int(t.cmd), t.dist, t.val, false});
+            }
+            timing_end[i] = timing_entry.size();
+        }
+    }
+}
+
 // Insert
 template <typename T>
 void DRAM<T>::insert(DRAM<T>* child)
@@ -241,6 +329,11 @@ void DRAM<T>::insert(DRAM<T>* child)
     child->parent = this;
     child->id = children.size();
     children.push_back(child);
+
+    DRAM<T>* root = this;
+    while (root->parent)
+        root = root->parent;
+    root->flatten();
 }
 
 // Decode
@@ -266,15 +359,20 @@ typename T::Command DRAM<T>::decode(typename T::Command cmd, const int* addr)
 template <typename T>
 bool DRAM<T>::check(typename T::Command cmd, const int* addr, long clk)
 {
-    if (next[int(cmd)] != -1 && clk < next[int(cmd)])
-        return false; // stop recursion: the check failed at this level
-
-    int child_id = addr[int(level)+1];
-    if (child_id < 0 || level == spec->scope[int(cmd)] || !children.size())
-        return true; // stop recursion: the check passed at all levels
-
-    // recursively check my child
-    return children[child_id]->check(cmd, addr, clk);
+    const int cmd_max = int(T::Command::MAX);
+    int scope = int(spec->scope[int(cmd)]);
+    int node = 0;
+    for (int l = int(level); ; l++) {
+        long next_clk = next[node * cmd_max + int(cmd)];
+        if (next_clk != -1 && clk < next_clk)
+            return false; // the check failed at this level
+
+        int child_id = addr[l + 1];
+        if (child_id < 0 || l == scope || !child_num[node])
+            return true; // the check passed at all levels
+
+        node = first_child[node] + child_id;
+    }
 }
 
 // SAUGATA: added function to check whether a command is a row hit
@@ -312,11 +410,12 @@ bool DRAM<T>::check_row_open(typename T::Command cmd, const int* addr)
 template <typename T>
 long DRAM<T>::get_next(typename T::Command cmd, const int* addr)
 {
+    const int cmd_max = int(T::Command::MAX);
     long next_clk = max(cur_clk, next[int(cmd)]);
-    auto node = this;
-    for (int l = int(level); l < int(spec->scope[int(cmd)]) && node->children.size() && addr[l + 1] >= 0; l++){
-        node = node->children[addr[l + 1]];
-        next_clk = max(next_clk, node->next[int(cmd)]);
+    int node = 0;
+    for (int l = int(level); l < int(spec->scope[int(cmd)]) && child_num[node] && addr[l + 1] >= 0; l++){
+        node = first_child[node] + addr[l + 1];
+        next_clk = max(next_clk, next[node * cmd_max + int(cmd)]);
     }
     return next_clk;
 }
@@ -353,56 +452,80 @@ void DRAM<T>::update_timing(typename T::Command cmd, const int* addr, long clk)
 {
     // I am not a target node: I am merely one of its siblings
     if (id != addr[int(level)]) {
-        for (auto& t : timing[int(cmd)]) {
-            if (!t.sibling)
-                continue; // not an applicable timing parameter
-
-            assert (t.dist == 1);
+        update_sibling(0, int(cmd), clk);
+        return;
+    }
 
-            long future = clk + t.val;
-            next[int(t.cmd)] = max(next[int(t.cmd)], future); // update future
+    // Some commands have timings that are higher that their scope levels, thus
+    // we do not stop at the cmd's scope level. *All* the children of a target
+    // node are updated, and only the one on the address path is a target.
+    update_target(0, int(cmd), clk);
+    int node = 0;
+    for (int l = int(level) + 1; child_num[node]; l++) {
+        int target = -1;
+        for (int i = 0; i < child_num[node]; i++) {
+            if (i == addr[l]) {
+                target = first_child[node] + i;
+                update_target(target, int(cmd), clk);
+            }
+            else
+                update_sibling(first_child[node] + i, int(cmd), clk);
         }
 
-        return; // stop recursion: only target nodes should be recursed
+        if (target < 0)
+            return; // updated all levels
+        node = target;
     }
+}
 
-    // I am a target node
-    if (prev[int(cmd)].size()) {
-        prev[int(cmd)].pop_back();  // FIXME TIANSHI why pop back?
-        prev[int(cmd)].push_front(clk); // update history
+template <typename T>
+void DRAM<T>::update_target(int node, int cmd, long clk)
+{
+    const int cmd_max = int(T::Command::MAX);
+    int i = node_level[node] * cmd_max + cmd;
+    int len = prev_len[i];
+    long* hist = &prev[prev_base[node * cmd_max + cmd]];
+    int& head = prev_head[node * cmd_max + cmd];
+    if (len) {
+        head = (head ? head : len) - 1;
+        hist[head] = clk; // update history
     }
 
-    for (auto& t : timing[int(cmd)]) {
-        if (t.sibling)
-            continue; // not an applicable timing parameter
-
-        long past = prev[int(cmd)][t.dist-1];
+    for (int e = target_begin[i]; e < sibling_begin[i]; e++) {
+        auto& t = timing_entry[e];
+        int slot = head + t.dist - 1;
+        long past = hist[slot < len ? slot : slot - len];
         if (past < 0)
             continue; // not enough history
 
         long future = past + t.val;
-        next[int(t.cmd)] = max(next[int(t.cmd)], future); // update future
+        long& next_clk = next[node * cmd_max + t.cmd];
+        next_clk = max(next_clk, future); // update future
         // TIANSHI: for refresh statistics
-        if (spec->is_refreshing(cmd) && spec->is_opening(t.cmd)) {
+        if (t.refresh) {
+          DRAM<T>* n = nodes[node];
           assert(past == clk);
-          begin_of_refreshing = clk;
-          end_of_refreshing = max(end_of_refreshing, next[int(t.cmd)]);
-          refresh_cycles += end_of_refreshing - clk;
-          if (cur_serving_requests > 0) {
-            refresh_intervals.push_back(make_pair(begin_of_refreshing, end_of_refreshing));
+          n->begin_of_refreshing = clk;
+          n->end_of_refreshing = max(n->end_of_refreshing, next_clk);
+          n->refresh_cycles += n->end_of_refreshing - clk;
+          if (n->cur_serving_requests > 0) {
+            n->refresh_intervals.push_back(make_pair(n->begin_of_refreshing, n->end_of_refreshing));
           }
         }
     }
+}
 
-    // Some commands have timings that are higher that their scope levels, thus
-    // we do not stop at the cmd's scope level
-    if (!children.size())
-        return; // stop recursion: updated all levels
-
-    // recursively update *all* of my children
-    for (auto child : children)
-        child->update_timing(cmd, addr, clk);
-
+template <typename T>
+void DRAM<T>::update_sibling(int node, int cmd, long clk)
+{
+    const int cmd_max = int(T::Command::MAX);
+    int i = node_level[node] * cmd_max + cmd;
+    for (int e = sibling_begin[i]; e < timing_end[i]; e++) {
+        auto& t = timing_entry[e];
+        long future = clk + t.val;
+        long& next_clk = next[node * cmd_max + t.cmd];
+        next_clk = max(next_clk, future); // update future
+    }
 }
 
 template <typename T>
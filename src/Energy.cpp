@@ -0,0 +1,50 @@
+/*
+ * Energy.cpp
+ *
+ * Default supply voltage and currents of the memory standards. The values
+ * are typical ones of a single device (or of a single channel for the 3D
+ * stacked standards) taken from the datasheets. The derived DDR3 standards
+ * (SALP, ALDRAM, TLDRAM and DSARP) share the DDR3 values.
+ */
+
+#include <map>
+#include <cstdlib>
+
+#include "Energy.h"
+
+using namespace std;
+using namespace ramulator;
+
+namespace ramulator {
+
+PowerEntry get_power_entry(const string& standard_name, const Config& configs)
+{
+    static const map<string, PowerEntry> power_table = {
+        // standard      vdd   idd0   idd2n  idd3n  idd4r  idd4w  idd5
+        {"DDR3",      {1.5,   55,    32,    38,    157,   128,   235}},
+        {"DDR4",      {1.2,   58,    37,    52,    154,   143,   250}},
+        {"LPDDR3",    {1.2,   65,    23,    30,    250,   230,   150}},
+        {"LPDDR4",    {1.1,   60,    30,    40,    250,   230,   180}},
+        {"GDDR5",     {1.5,   700,   450,   600,   1300,  1250,  1500}},
+        {"HBM",       {1.2,   75,    35,    50,    200,   210,   150}},
+        {"WideIO",    {1.2,   25,    5,     10,    90,    80,    60}},
+        {"WideIO2",   {1.1,   30,    8,     12,    120,   110,   80}},
+    };
+
+    PowerEntry p = power_table.at("DDR3");
+    auto it = power_table.find(standard_name);
+    if (it != power_table.end())
+        p = it->second;
+
+    if (configs.contains("vdd"))   p.vdd = atof(configs["vdd"].c_str());
+    if (configs.contains("idd0"))  p.idd0 = atof(configs["idd0"].c_str());
+    if (configs.contains("idd2n")) p.idd2n = atof(configs["idd2n"].c_str());
+    if (configs.contains("idd3n")) p.idd3n = atof(configs["idd3n"].c_str());
+    if (configs.contains("idd4r")) p.idd4r = atof(configs["idd4r"].c_str());
+    if (configs.contains("idd4w")) p.idd4w = atof(configs["idd4w"].c_str());
+    if (configs.contains("idd5"))  p.idd5 = atof(configs["idd5"].c_str());
+
+    return p;
+}
+
+} /*namespace ramulator*/
@@ -0,0 +1,199 @@
+/*
+ * Energy.h
+ *
+ * In-process DRAM energy model following the IDD based method of the
+ * Micron power calculator (TN-41-01). The energy of each command is
+ * accumulated as it is issued by the controller and the background energy
+ * is accumulated per memory cycle, so no command trace has to be recorded
+ * and post-processed.
+ *
+ *   ACT  (IDD0 - IDD3N) * tRAS
+ *   PRE  (IDD0 - IDD2N) * (tRC - tRAS), per closed row
+ *   RD   (IDD4R - IDD3N) * tBL
+ *   WR   (IDD4W - IDD3N) * tBL
+ *   REF  (IDD5 - IDD3N) * tRFC, scaled by the refreshed banks
+ *   background  IDD3N with any row open in the rank, IDD2N otherwise
+ *
+ * All the terms are multiplied by VDD and the number of devices per rank.
+ * Power-down modes are not modeled. The currents are typical datasheet
+ * values per device and they can be overridden in the memory configuration
+ * file with the keys vdd, idd0, idd2n, idd3n, idd4r, idd4w and idd5.
+ */
+
+#ifndef __ENERGY_H
+#define __ENERGY_H
+
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Statistics.h"
+
+using namespace std;
+
+namespace ramulator {
+
+template <typename T>
+class Controller;
+
+// Supply voltage in V and currents in mA of a single device.
+struct PowerEntry {
+    double vdd;
+    double idd0, idd2n, idd3n;
+    double idd4r, idd4w, idd5;
+};
+
+// Energy in pJ, accumulated over all the channels.
+struct EnergyBreakdown {
+    double act = 0, pre = 0, rd = 0, wr = 0, ref = 0, background = 0;
+
+    double total() const {
+        return act + pre + rd + wr + ref + background;
+    }
+};
+
+PowerEntry get_power_entry(const string& standard_name, const Config& configs);
+
+template <typename T>
+class Energy {
+public:
+    Controller<T>* ctrl;
+
+    ScalarStat act_energy;
+    ScalarStat pre_energy;
+    ScalarStat read_energy;
+    ScalarStat write_energy;
+    ScalarStat refresh_energy;
+    ScalarStat background_energy;
+
+    Energy(Controller<T>* ctrl, const Config& configs) : ctrl(ctrl) {
+        T* spec = ctrl->channel->spec;
+        auto& s = spec->speed_entry;
+        PowerEntry p = get_power_entry(spec->standard_name, configs);
+
+        // mA * V * ns = pJ
+        double devices = double(spec->channel_width) / spec->org_entry.dq;
+        double scale = p.vdd * s.tCK * devices;
+
+        int bank_num = 1;
+        for (int lev = int(T::Level::Rank) + 1; lev <= int(T::Level::Bank); lev++)
+            bank_num *= spec->org_entry.count[lev];
+
+        cmd_energy.resize(int(T::Command::MAX), 0);
+        cmd_type.resize(int(T::Command::MAX), Type::NONE);
+        for (int i = 0; i < int(T::Command::MAX); i++) {
+            typename T::Command cmd = typename T::Command(i);
+            const string& name = spec->command_name[i];
+            if (spec->is_opening(cmd)) {
+                cmd_type[i] = Type::ACT;
+                cmd_energy[i] = (p.idd0 - p.idd3n) * s.nRAS * scale;
+            } else if (spec->is_accessing(cmd) && name.compare(0, 2, "RD") == 0) {
+                cmd_type[i] = Type::RD;
+                cmd_energy[i] = (p.idd4r - p.idd3n) * s.nBL * scale;
+            } else if (spec->is_accessing(cmd) && name.compare(0, 2, "WR") == 0) {
+                cmd_type[i] = Type::WR;
+                cmd_energy[i] = (p.idd4w - p.idd3n) * s.nBL * scale;
+            } else if (spec->is_refreshing(cmd)) {
+                // A bank level refresh covers a single bank of the rank.
+                double portion = 1.0;
+                for (int lev = int(spec->scope[i]) + 1; lev <= int(T::Level::Bank); lev++)
+                    portion *= spec->org_entry.count[lev];
+                cmd_type[i] = Type::REF;
+                cmd_energy[i] = (p.idd5 - p.idd3n) * get_refresh_cycles(cmd) * scale * portion / bank_num;
+            }
+        }
+        pre_row_energy = (p.idd0 - p.idd2n) * (s.nRC - s.nRAS) * scale;
+        standby_energy = p.idd2n * scale;
+        active_energy = p.idd3n * scale;
+
+        int rank_num = ctrl->channel->children.size();
+        open_rows.resize(rank_num, 0);
+
+        string suffix = "_channel_" + to_string(ctrl->channel->id);
+        act_energy
+            .name("act_energy" + suffix)
+            .desc("Activation energy (pJ) per channel")
+            .precision(0)
+            ;
+        pre_energy
+            .name("pre_energy" + suffix)
+            .desc("Precharge energy (pJ) per channel")
+            .precision(0)
+            ;
+        read_energy
+            .name("read_energy" + suffix)
+            .desc("Read burst energy (pJ) per channel")
+            .precision(0)
+            ;
+        write_energy
+            .name("write_energy" + suffix)
+            .desc("Write burst energy (pJ) per channel")
+            .precision(0)
+            ;
+        refresh_energy
+            .name("refresh_energy" + suffix)
+            .desc("Refresh energy (pJ) per channel")
+            .precision(0)
+            ;
+        background_energy
+            .name("background_energy" + suffix)
+            .desc("Active and precharge standby energy (pJ) per channel")
+            .precision(0)
+            ;
+    }
+
+    // Called for each issued command. opened and closed are the number of
+    // rows opened and closed by the command in the rank.
+    void update(typename T::Command cmd, int rank, int opened, int closed) {
+        switch (cmd_type[int(cmd)]) {
+            case Type::ACT: act_energy += cmd_energy[int(cmd)]; break;
+            case Type::RD:  read_energy += cmd_energy[int(cmd)]; break;
+            case Type::WR:  write_energy += cmd_energy[int(cmd)]; break;
+            case Type::REF: refresh_energy += cmd_energy[int(cmd)]; break;
+            default: break;
+        }
+        pre_energy += closed * pre_row_energy;
+        open_rows[rank] += opened - closed;
+    }
+
+    void tick() {
+        for (int rows : open_rows)
+            background_energy += (rows > 0) ? active_energy : standby_energy;
+    }
+
+    EnergyBreakdown get_breakdown() {
+        EnergyBreakdown e;
+        e.act = act_energy.value();
+        e.pre = pre_energy.value();
+        e.rd = read_energy.value();
+        e.wr = write_energy.value();
+        e.ref = refresh_energy.value();
+        e.background = background_energy.value();
+        return e;
+    }
+
+private:
+    enum class Type { NONE, ACT, RD, WR, REF };
+
+    vector<double> cmd_energy;
+    vector<Type> cmd_type;
+    double pre_row_energy;
+    double standby_energy;
+    double active_energy;
+    vector<int> open_rows;
+
+    // tRFC is the delay from the refresh to the next activation.
+    int get_refresh_cycles(typename T::Command ref) {
+        T* spec = ctrl->channel->spec;
+        int cycles = 0;
+        for (int lev = 0; lev < int(T::Level::MAX); lev++)
+            for (auto& t : spec->timing[lev][int(ref)])
+                if (!t.sibling && spec->is_opening(t.cmd) && t.val > cycles)
+                    cycles = t.val;
+        return cycles;
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__ENERGY_H*/
@@ -1,41 +1,66 @@
 #include "MemWrapper.h"
+#include "Sweep.h"
 #include "pe.h"
+#include <memory>
 
-int sc_main(int argc, char *argv[]){
-
-    sc_set_time_resolution(1, SC_NS);
+// Run a single bfs simulation on the accelerator.
+int runAcc(int argc, char *argv[]){
 
-    // Only burstIdx is transferred.
-    sc_signal<long> burstReq[PNUM];
-    sc_signal<long> burstResp[PNUM];
-    sc_signal<bool> bfsDone;
+    // Only burstIdx and the returned request credits are transferred. 
+    // Each pe has PNUM ports and only the first pe drives the bfsDone 
+    // signal of the memory.
+    int portNum = PNUM * GL::peNum;
+    std::unique_ptr<sc_signal<long>[]> burstReq(new sc_signal<long>[portNum]);
+    std::unique_ptr<sc_signal<long>[]> burstResp(new sc_signal<long>[portNum]);
+    std::unique_ptr<sc_signal<long>[]> reqCredit(new sc_signal<long>[portNum]);
+    std::unique_ptr<sc_signal<bool>[]> bfsDone(new sc_signal<bool>[GL::peNum]);
 
-    double peClkCycle = 2500;
-    double memClkCycle = 625;
+    double peClkCycle = GL::peClkCycle;
+    double memClkCycle = GL::memClkCycle;
     sc_clock peClk("peClk", peClkCycle, SC_NS, 0.5);
 
-    GL::cfgBfsParam("./config.txt");
     MemWrapper memWrapper("memWrapper", memClkCycle, peClkCycle, argc, argv);
     memWrapper.setNewStartVertex(GL::startingVertices[0]);
     std::cout << "start vertex: " << GL::startingVertices[0] << std::endl;
-    for(int i = 0; i < PNUM; i++){
+    for(int i = 0; i < portNum; i++){
         memWrapper.burstReq[i](burstReq[i]);
         memWrapper.burstResp[i](burstResp[i]);
+        memWrapper.reqCredit[i](reqCredit[i]);
     }
-    memWrapper.bfsDone(bfsDone);
+    memWrapper.bfsDone(bfsDone[0]);
     memWrapper.sigInit();
 
-    pe peInst("peInst", 0, peClkCycle);
-    for(int i = 0; i < PNUM; i++){
-        peInst.burstReq[i](burstReq[i]);
-        peInst.burstResp[i](burstResp[i]);
+    std::vector<std::unique_ptr<pe>> pes;
+    for(int p = 0; p < GL::peNum; p++){
+        std::string peName = "peInst" + (p == 0 ? std::string("") : std::to_string(p));
+        pes.emplace_back(new pe(peName.c_str(), p, peClkCycle));
+        for(int i = 0; i < PNUM; i++){
+            pes[p]->burstReq[i](burstReq[p * PNUM + i]);
+            pes[p]->burstResp[i](burstResp[p * PNUM + i]);
+            pes[p]->reqCredit[i](reqCredit[p * PNUM + i]);
+        }
+        pes[p]->bfsDone(bfsDone[p]);
+        pes[p]->peClk(peClk);
+        pes[p]->sigInit();
     }
-    peInst.bfsDone(bfsDone);
-    peInst.peClk(peClk);
-    peInst.sigInit();
 
     sc_start();
 
     return 0;
 
 }
+
+int sc_main(int argc, char *argv[]){
+
+    sc_set_time_resolution(1, SC_PS);
+    GL::cfgBfsParam("./config.txt");
+
+    // Parameter sweep: ramulator <configs-file> --mode=sweep <sweep-file>
+    if(argc >= 4 && std::string(argv[2]) == "--mode=sweep"){
+        Sweep sweep(argv[3], argv[1]);
+        return sweep.run(argv[0], runAcc);
+    }
+
+    return runAcc(argc, argv);
+
+}
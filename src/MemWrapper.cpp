@@ -1,4 +1,7 @@
 #include "MemWrapper.h"
+#include "program.h"
+
+Graph* MemWrapper::graph = NULL;
 
 // The memory configuration is initially ported from ramulator.
 // which are mostly parsed from input argument. We don't want to change it for now.
@@ -10,13 +13,76 @@ MemWrapper::MemWrapper(sc_module_name _name,
     : sc_module(_name), configs(argv[1]){
 
     loadConfig(argc, argv);
-    burstReqQueue.resize(PNUM);
-    burstRespQueue.resize(PNUM);
-    memClkCycle = _memClkCycle; 
     peClkCycle = _peClkCycle; 
-    GL::burstLen = calBurstLen();
+    cfgSpecParam();
+
+    // The memory clock follows tCK of the DRAM standard 
+    // unless it is explicitly specified.
+    memClkCycle = _memClkCycle; 
+    if(memClkCycle <= 0){
+        memClkCycle = specClkCycle;
+    }
+    if(GL::logon != 0){
+        std::cout << "pe clock period: " << peClkCycle << " ns" << std::endl;
+        std::cout << "memory clock period: " << memClkCycle << " ns" << std::endl;
+    }
+    if(GL::memIssueWidth < 1 || GL::chanQueueDepth < 1){
+        HERE;
+        std::cout << "Invalid memIssueWidth " << GL::memIssueWidth;
+        std::cout << " or chanQueueDepth " << GL::chanQueueDepth << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(VertexProgram::isAsync() && GL::frontierMode != FrontierMode::DENSE){
+        HERE;
+        std::cout << "asyncBfs, sssp and cc work with the dense frontierMode." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(GL::verifyBfs != 0 && GL::algorithm == Algorithm::CC){
+        HERE;
+        std::cout << "verifyBfs works with the bfs, sssp and pagerank algorithms." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(GL::algorithm != Algorithm::BFS && GL::frontierMode != FrontierMode::DENSE){
+        HERE;
+        std::cout << VertexProgram::getName() << " works with the dense frontierMode." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if((GL::algorithm == Algorithm::SSSP || GL::algorithm == Algorithm::PAGERANK) && 
+       GL::ciaoFormat != CiaoFormat::RAW){
+        HERE;
+        std::cout << VertexProgram::getName() << " works with the raw ciaoFormat." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(GL::getBaseLen(5) % VertexProgram::getEdgeSize() != 0){
+        HERE;
+        std::cout << "The ciao split length " << GL::getBaseLen(5) << " must be a multiple of ";
+        std::cout << VertexProgram::getEdgeSize() << ", the bytes of an edge." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(GL::algorithm == Algorithm::PAGERANK && GL::asyncBfs != 0){
+        HERE;
+        std::cout << "PageRank works without asyncBfs." << std::endl;
+        exit(EXIT_FAILURE);
+    }
     ramInit("./config.txt");
 
+    // Each pe has PNUM ports.
+    portNum = PNUM * GL::peNum;
+    burstReq = new sc_in<long>[portNum];
+    burstResp = new sc_out<long>[portNum];
+    reqCredit = new sc_out<long>[portNum];
+    burstReqQueue.resize(portNum);
+    burstRespQueue.resize(portNum);
+    reqQueue.resize(portNum);
+    freedCredit.resize(portNum, 0);
+    skippedCycles = 0;
+    arbiter = new PortArbiter(portNum);
+    portReqNum.resize(PNUM, 0);
+    portLatency.resize(PNUM);
+    portReadBurstNum.resize(PNUM, 0);
+    portWriteBurstNum.resize(PNUM, 0);
+    depthWriteNum = 0;
+
     SC_THREAD(runMemSim);
     SC_THREAD(getBurstReq);
     SC_THREAD(sendBurstResp);
@@ -25,6 +91,10 @@ MemWrapper::MemWrapper(sc_module_name _name,
 }
 
 Graph* MemWrapper::loadGraph(const std::string &cfgFileName){
+    if(graph != NULL){
+        return graph;
+    }
+
     std::ifstream fhandle(cfgFileName.c_str());
     if(!fhandle.is_open()){
         HERE;
@@ -99,49 +169,64 @@ Graph* MemWrapper::loadGraph(const std::string &cfgFileName){
     GL::edgeNum = gptr->edge_num;
     gptr->getRandomStartIndices(GL::startingVertices);
     //gptr->printOngb(GL::startingVertices[0]);
+    graph = gptr;
 
     return gptr;
 
 }
 
 void MemWrapper::sigInit(){
-    for(int i = 0; i < PNUM; i++){
+    for(int i = 0; i < portNum; i++){
         burstResp[i].write(-1);
+        reqCredit[i].write(0);
     }
 }
 
 // To prepare for new bfs traverse, we need to clean 
 // both the initial depth and frontier data.
 void MemWrapper::cleanRam(){
-    long depthAddr = GL::depthMemAddr; 
-    for(int i = 0; i < GL::vertexNum; i++){
-        updateSingleDataToRam<signed char>(depthAddr, -1);
-        depthAddr += (long)sizeof(signed char);
+    for(const auto &part : GL::partitions){
+        long frontierAddr = part.frontierMemAddr;
+        initProps(part);
+        while(frontierAddr < part.endAddr){
+            updateSingleDataToRam<vidx_t>(frontierAddr, -1);
+            frontierAddr += (long)sizeof(vidx_t);
+        }
     }
-
-    long frontierAddr = GL::frontierMemAddr;
-    for(int i = 0; i < GL::vertexNum; i++){
-        updateSingleDataToRam<int>(frontierAddr, -1);
-        frontierAddr += (long)sizeof(int);
+    for(auto &part : GL::partitions){
+        part.frontierSize = 0;
     }
 }
 
-void MemWrapper::setNewStartVertex(int idx){
-    long addr = GL::depthMemAddr + idx * sizeof(signed char);
-    updateSingleDataToRam<signed char>(addr, 0);
+// idx is the original vertex index before the reordering.
+// The starting vertex is also the only vertex in the first frontier 
+// queue of its partition.
+void MemWrapper::setNewStartVertex(vidx_t idx){
+    vidx_t vidx = graph->getNewId(idx);
+    Partition &part = GL::partitions[GL::getPartitionIdx(vidx)];
+    if(VertexProgram::isRooted()){
+        VertexProgram::setProp(&ramData[GL::getDepthMemAddr(vidx)], VertexProgram::getRootProp());
+    }
+    updateSingleDataToRam<vidx_t>(part.frontierMemAddr, vidx);
+    part.frontierSize = 1;
 }
 
-// It reads request from pe and thus is synchronized to the pe's clock
+// It reads request from pe and thus is synchronized to the pe's clock. 
+// The credits freed in the last pe cycle are returned at the same time.
 void MemWrapper::getBurstReq(){
     while(true){
-        for(int i = 0; i < PNUM; i++){
+        for(int i = 0; i < portNum; i++){
+            reqCredit[i].write(freedCredit[i]);
+            freedCredit[i] = 0;
             long burstIdx = burstReq[i].read();
             if(burstIdx != -1){
                 BurstOp* ptr = GL::bursts[burstIdx];
                 burstReqQueue[i].push_back(burstIdx);
                 totalReqNum[burstIdx] = ptr->getReqNum(); 
                 processedReqNum[burstIdx] = 0;
-                ptr->convertToReq(reqQueue);
+                ptr->convertToReq(reqQueue[i]);
+                arbiter->push(i, totalReqNum[burstIdx]);
+                reqArrival.notify();
             }
         }
         wait(peClkCycle, SC_NS);
@@ -153,7 +238,7 @@ void MemWrapper::getBurstReq(){
 // sent at the right timestamp.
 void MemWrapper::sendBurstResp(){
     while(true){
-        for(int i = 0; i < PNUM; i++){
+        for(int i = 0; i < portNum; i++){
             if(burstReqQueue[i].empty()){
                 burstResp[i].write(-1);
                 continue;
@@ -167,14 +252,22 @@ void MemWrapper::sendBurstResp(){
             else{
                 BurstOp* ptr = GL::bursts[idx];
                 long respReadyTime = ptr->departMemTime; 
-                long currentTimeStamp = (long)(sc_time_stamp()/sc_time(1, SC_NS));
+                long currentTimeStamp = GL::getTimeStamp();
                 if(respReadyTime <= currentTimeStamp){
                     burstResp[i].write(idx);
+                    long latency = currentTimeStamp - ptr->departPeTime;
+                    portLatency[i % PNUM].add(latency);
                     if(ptr->type == ramulator::Request::Type::WRITE){
                         ptr->reqToRam(ramData);
+                        portWriteBurstNum[i % PNUM]++;
+                        const Partition &part = GL::partitions[i / PNUM];
+                        if(ptr->addr >= part.depthMemAddr && ptr->addr < part.rpaoMemAddr){
+                            depthWriteNum++;
+                        }
                     }
                     else{
                         ptr->ramToReq(ramData);
+                        portReadBurstNum[i % PNUM]++;
                     }
 
                     burstReqQueue[i].pop_front();
@@ -186,51 +279,40 @@ void MemWrapper::sendBurstResp(){
     }
 }
 
-int MemWrapper::calBurstLen(){
+// Basic memory burst length and clock period depend on the memory standard.
+void MemWrapper::cfgSpecParam(){
 
-    int burstlen;
     if (standard == "DDR3") {
-        DDR3* ddr3 = new DDR3(configs["org"], configs["speed"]);
-        burstlen = ddr3->prefetch_size * ddr3->channel_width / 8;
+        getSpecParam(new DDR3(configs["org"], configs["speed"]));
     } else if (standard == "DDR4") {
-        DDR4* ddr4 = new DDR4(configs["org"], configs["speed"]);
-        burstlen = ddr4->prefetch_size * ddr4->channel_width / 8;
+        getSpecParam(new DDR4(configs["org"], configs["speed"]));
     } else if (standard == "SALP-MASA") {
-        SALP* salp8 = new SALP(configs["org"], configs["speed"], "SALP-MASA", configs.get_subarrays());
-        burstlen = salp8->prefetch_size * salp8->channel_width / 8;
+        getSpecParam(new SALP(configs["org"], configs["speed"], "SALP-MASA", configs.get_subarrays()));
     } else if (standard == "LPDDR3") {
-        LPDDR3* lpddr3 = new LPDDR3(configs["org"], configs["speed"]);
-        burstlen = lpddr3->prefetch_size * lpddr3->channel_width / 8;
+        getSpecParam(new LPDDR3(configs["org"], configs["speed"]));
     } else if (standard == "LPDDR4") {
         // total cap: 2GB, 1/2 of others
-        LPDDR4* lpddr4 = new LPDDR4(configs["org"], configs["speed"]);
-        burstlen = lpddr4->prefetch_size * lpddr4->channel_width / 8;
+        getSpecParam(new LPDDR4(configs["org"], configs["speed"]));
     } else if (standard == "GDDR5") {
-        GDDR5* gddr5 = new GDDR5(configs["org"], configs["speed"]);
-        burstlen = gddr5->prefetch_size * gddr5->channel_width / 8;
+        getSpecParam(new GDDR5(configs["org"], configs["speed"]));
     } else if (standard == "HBM") {
-        HBM* hbm = new HBM(configs["org"], configs["speed"]);
-        burstlen = hbm->prefetch_size * hbm->channel_width / 8;
+        getSpecParam(new HBM(configs["org"], configs["speed"]));
     } else if (standard == "WideIO") {
         // total cap: 1GB, 1/4 of others
-        WideIO* wio = new WideIO(configs["org"], configs["speed"]);
-        burstlen = wio->prefetch_size * wio->channel_width / 8;
+        getSpecParam(new WideIO(configs["org"], configs["speed"]));
     } else if (standard == "WideIO2") {
         // total cap: 2GB, 1/2 of others
         WideIO2* wio2 = new WideIO2(configs["org"], configs["speed"], configs.get_channels());
         wio2->channel_width *= 2;
-        burstlen = wio2->prefetch_size * wio2->channel_width / 8;
+        getSpecParam(wio2);
     }
     // Various refresh mechanisms
     else if (standard == "DSARP") {
-        DSARP* dsddr3_dsarp = new DSARP(configs["org"], configs["speed"], DSARP::Type::DSARP, configs.get_subarrays());
-        burstlen = dsddr3_dsarp->prefetch_size * dsddr3_dsarp->channel_width / 8;
+        getSpecParam(new DSARP(configs["org"], configs["speed"], DSARP::Type::DSARP, configs.get_subarrays()));
     } else if (standard == "ALDRAM") {
-        ALDRAM* aldram = new ALDRAM(configs["org"], configs["speed"]);
-        burstlen = aldram->prefetch_size * aldram->channel_width / 8;
+        getSpecParam(new ALDRAM(configs["org"], configs["speed"]));
     } else if (standard == "TLDRAM") {
-        TLDRAM* tldram = new TLDRAM(configs["org"], configs["speed"], configs.get_subarrays());
-        burstlen = tldram->prefetch_size * tldram->channel_width / 8;
+        getSpecParam(new TLDRAM(configs["org"], configs["speed"], configs.get_subarrays()));
     }
     else{
         HERE;
@@ -238,7 +320,6 @@ int MemWrapper::calBurstLen(){
         exit(EXIT_FAILURE);
     }
 
-    return burstlen;
 }
 
 void MemWrapper::runMemSim(){
@@ -347,21 +428,26 @@ void MemWrapper::start_run(const Config& configs, T* spec, const vector<const ch
     }
 }
 
-// The reqQueue can always accept requests from pe, 
-// but the memory requests may not be processed by the 
-// ramulator due to the internal queue limitation. This 
-// infinite queue here is used to simplify the synchronization 
-// between pe and ramulator. For example, they don't have to 
-// constantly check the internal queue if it is ready to accept 
-// new requests. At the same time, it keeps the original parallel 
-// memory processing limitation of the DRAM model.
+// The reqQueue accepts the requests from pe as long as the pe 
+// port holds the credits, but the memory requests may not be 
+// processed by the ramulator due to the internal queue limitation. 
+// With the default infinite queue, pe and ramulator don't have to 
+// check if the other side is ready to accept new requests, while 
+// the original parallel memory processing limitation of the DRAM 
+// model is kept. A finite reqQueueDepth returns the credit of each 
+// request sent to the ramulator, so that the backpressure of the 
+// memory controller queues reaches the pe ports. The port of the 
+// next request is picked by the arbiter.
 bool MemWrapper::getMemReq(Request &req){
-    std::list<Request>::iterator it;
-    if(reqQueue.empty() == false){
-        Request tmp = reqQueue.front();
+    int port = arbiter->pick(reqQueue);
+    if(port != -1){
+        Request tmp = reqQueue[port].front();
         shallowReqCopy(tmp, req);
-        req.udf.arriveMemTime = (long)(sc_time_stamp()/sc_time(1, SC_NS));
-        reqQueue.pop_front();
+        req.addr = getChannelAddr(req.addr);
+        req.udf.arriveMemTime = GL::getTimeStamp();
+        reqQueue[port].pop_front();
+        freedCredit[port]++;
+        portReqNum[port % PNUM]++;
         return true;
     }
     else{
@@ -372,21 +458,21 @@ bool MemWrapper::getMemReq(Request &req){
 template<typename T>
 void MemWrapper::run_acc(const Config& configs, Memory<T, Controller>& memory) {
     /* run simulation */
-    bool stall = false;
-    bool success = false;
     int reads = 0;
     int writes = 0;
-    int clks = 0;
+    long clks = 0;
     Request::Type type = Request::Type::READ;
     map<int, int> latencies;
 
-    // Callback function
-    auto read_complete = [this, &latencies](Request& r){
+    // Callback function. It is invoked for the writes as well in the 
+    // writeComplete mode.
+    auto req_complete = [this, &latencies](Request& r){
         long latency = r.depart - r.arrive;
         latencies[latency]++;
 
-        //update departMemTime
-        r.udf.departMemTime = r.udf.arriveMemTime + memClkCycle * latency;
+        // The callback is invoked in memory.tick() when the data is 
+        // returned or written, so the current time stamp is the depart time.
+        r.udf.departMemTime = GL::getTimeStamp();
         int burstIdx = r.udf.burstIdx;
 
         processedReqNum[burstIdx]++;
@@ -395,46 +481,147 @@ void MemWrapper::run_acc(const Config& configs, Memory<T, Controller>& memory) {
         }
         if(processedReqNum[burstIdx] == totalReqNum[burstIdx]){
             GL::bursts[burstIdx]->departMemTime = r.udf.departMemTime;
-            burstRespQueue[r.udf.portIdx].push_back(burstIdx);
+            burstRespQueue[r.udf.peIdx * PNUM + r.udf.portIdx].push_back(burstIdx);
         }
     };
 
     std::vector<int> addr_vec;
-    Request req(addr_vec, type, read_complete);
+    Request req(addr_vec, type, req_complete);
+    for(auto ctrl : memory.ctrls){
+        ctrl->write_callback = (GL::writeComplete != 0);
+    }
+    // The idle cycles skipped till the time until are applied to the 
+    // memory model. The energy is read after the cycles before now.
+    long skipEnd = 0;
+    auto skipIdle = [this, &memory, &clks, &skipEnd](const sc_time &until){
+        long cycles = 0;
+        while(clks + cycles < skipEnd && 
+              sc_time((clks + cycles + 1) * memClkCycle, SC_NS) <= until)
+        {
+            cycles++;
+        }
+        memory.skip_idle(cycles);
+        clks += cycles;
+        Stats::curTick += cycles;
+        skippedCycles += cycles;
+    };
+    getMemEnergy = [&memory, &skipIdle](){ 
+        skipIdle(sc_time_stamp() - sc_time(1, SC_PS));
+        return memory.get_energy(); 
+    };
+
+    auto sendReq = [this, &memory, &reads, &writes](Request &req){
+        if (!memory.send(req)){
+            return false;
+        }
+        if (req.type == Request::Type::READ){ 
+            reads++;
+        }
+        else if (req.type == Request::Type::WRITE){ 
+            writes++;
+            if(GL::writeComplete != 0){
+                return true;
+            }
+
+            // At this time, we can already assume that the write operation is done.
+            req.udf.departMemTime = GL::getTimeStamp();
+            int burstIdx = req.udf.burstIdx;
+            processedReqNum[burstIdx]++;
+            if(processedReqNum[burstIdx] ==1){
+                GL::bursts[burstIdx]->arriveMemTime = req.udf.arriveMemTime;
+            }
+            if(processedReqNum[burstIdx] == totalReqNum[burstIdx]){
+                GL::bursts[burstIdx]->departMemTime = req.udf.departMemTime;
+                burstRespQueue[req.udf.peIdx * PNUM + req.udf.portIdx].push_back(burstIdx);
+            }
+        }
+        return true;
+    };
+
+    // Up to memIssueWidth requests are picked from reqQueue per memory 
+    // cycle and routed to the queue of their channel. A channel that 
+    // rejects its request only stalls its own queue, and the picking 
+    // stops when any of the channel queues is full. The channel queues 
+    // are served from a rotating channel with memIssueWidth requests 
+    // per cycle in total. The default width and depth of 1 send one 
+    // request per cycle and stall the whole stream on a rejection.
+    int chanNum = memory.ctrls.size();
+    int chanTurn = 0;
+    std::vector<std::list<Request>> chanQueue(chanNum);
+    auto isChanQueueFull = [&chanQueue](){
+        for(const auto &q : chanQueue){
+            if((int)q.size() >= GL::chanQueueDepth){
+                return true;
+            }
+        }
+        return false;
+    };
 
     // Keep waiting for the memory request processing
     while (true){
-        if (!stall){
-            success = getMemReq(req);  
+        for(int n = 0; n < GL::memIssueWidth && !isChanQueueFull(); n++){
+            if(!getMemReq(req)){
+                break;
+            }
+            chanQueue[memory.get_channel(req.addr)].push_back(req);
         }
 
-        if (success){
-            stall = !memory.send(req); 
-            if (!stall){
-                if (req.type == Request::Type::READ){ 
-                    reads++;
-                }
-                // At this time, we can already assume that the write operation is done.
-                else if (req.type == Request::Type::WRITE){ 
-                    writes++;
-                    long currentTimeStamp = (long)(sc_time_stamp()/sc_time(1, SC_NS));
-                    req.udf.departMemTime = currentTimeStamp;
-                    int burstIdx = req.udf.burstIdx;
-                    processedReqNum[burstIdx]++;
-                    if(processedReqNum[burstIdx] ==1){
-                        GL::bursts[burstIdx]->arriveMemTime = req.udf.arriveMemTime;
-                    }
-                    if(processedReqNum[burstIdx] == totalReqNum[burstIdx]){
-                        GL::bursts[burstIdx]->departMemTime = req.udf.departMemTime;
-                        burstRespQueue[req.udf.portIdx].push_back(burstIdx);
-                    }
-                }
+        bool busy = false;
+        int sent = 0;
+        for(int i = 0; i < chanNum; i++){
+            std::list<Request> &q = chanQueue[(chanTurn + i) % chanNum];
+            busy = busy || !q.empty();
+            while(!q.empty() && sent < GL::memIssueWidth && sendReq(q.front())){
+                q.pop_front();
+                sent++;
+            }
+        }
+        chanTurn = (chanTurn + 1) % chanNum;
+
+        // When the memory is idle and there is no request to send, the 
+        // idle cycles are skipped at once till the memory may have something 
+        // to do or new requests arrive. The cycles till the arrival are 
+        // skipped, and the requests are sent after the next tick as usual 
+        // unless they arrive right at a memory cycle.
+        long idleCycles = 0;
+        if(GL::memIdleSkip != 0 && !busy){
+            idleCycles = memory.get_idle_cycles();
+        }
+        if(idleCycles > 0){
+            skipEnd = clks + idleCycles;
+            wait(sc_time(skipEnd * memClkCycle, SC_NS) - sc_time_stamp(), reqArrival);
+            skipIdle(sc_time_stamp());
+            skipEnd = clks;
+            if(sc_time_stamp() <= sc_time(clks * memClkCycle, SC_NS)){
+                continue;
             }
         }
 
-        wait(memClkCycle, SC_NS);
+        // The memory clock period is usually not a multiple of the pe clock 
+        // period or even the time resolution. The next memory cycle is located 
+        // with the absolute cycle count so that the rounding error of each 
+        // cycle does not accumulate.
+        sc_time nextTick = sc_time((clks + 1) * memClkCycle, SC_NS);
+        wait(nextTick - sc_time_stamp());
         memory.tick();
         clks ++;
+
+        // The requests waiting in reqQueue are counted as well, since 
+        // they are the backlog of the full controller queues.
+        if(GL::adaptiveBaseLen != 0){
+            long occupied = 0;
+            for(const auto &q : reqQueue){
+                occupied += q.size();
+            }
+            for(const auto &q : chanQueue){
+                occupied += q.size();
+            }
+            for(auto ctrl : memory.ctrls){
+                occupied += ctrl->readq.size();
+            }
+            long capacity = (long)memory.ctrls.size() * memory.ctrls[0]->readq.max;
+            GL::memQueueOccupancy = (double)occupied / capacity;
+        }
         Stats::curTick++; // memory clock, global, for Statistics
     }
     // This a workaround for statistics set only initially lost in the end
@@ -455,40 +642,24 @@ void MemWrapper::shallowReqCopy(const Request &simpleReq, Request &req){
 // moved to somewhere that is easy to be noticed.
 void MemWrapper::ramInit(const std::string &cfgFileName){
     Graph* gptr = loadGraph(cfgFileName);
-    ramData.resize(GL::edgeNum * 4 * 4);
-
-    std::vector<signed char> depth;
-    //std::vector<float> weight;
-    std::vector<int> rpao;
-    std::vector<int> ciao;
-    std::vector<int> rpai;
-    std::vector<int> ciai;
-    std::vector<int> frontier;
-
-    rpao.resize(gptr->vertex_num + 1);
-    rpai.resize(gptr->vertex_num + 1);
-    rpao[0] = 0;
-    rpai[0] = 0;
-    for(int i = 0; i < gptr->vertex_num; i++){
-        rpao[i+1] = rpao[i] + gptr->vertices[i]->out_deg;
-        rpai[i+1] = rpai[i] + gptr->vertices[i]->in_deg;
-    }
-
-    for(int i = 0; i < gptr->vertex_num; i++){
-        for(auto id : gptr->vertices[i]->out_vids){
-            ciao.push_back(id);
-        }
-        for(auto id : gptr->vertices[i]->in_vids){
-            ciai.push_back(id);
-        }
+    gptr->reorder(GL::vertexOrder);
+    if(GL::peNum < 1 || GL::peNum > GL::vertexNum){
+        HERE;
+        std::cout << "Invalid pe num " << GL::peNum << std::endl;
+        exit(EXIT_FAILURE);
     }
 
-    depth.resize(gptr->vertex_num);
-    frontier.resize(gptr->vertex_num);
-    for(int i = 0; i < gptr->vertex_num; i++){
-        depth[i] = -1;
-        frontier[i] = -1;
+    // The compressed ciao is addressed in bytes by rpaoc, 
+    // which replaces rpao in the memory.
+    std::vector<eidx_t> rpaoc;
+    std::vector<char> ciaoc;
+    if(GL::ciaoFormat != CiaoFormat::RAW){
+        compressCiao(gptr, rpaoc, ciaoc);
+        std::cout << "ciao is compressed from " << (long)sizeof(vidx_t) * GL::edgeNum;
+        std::cout << " to " << ciaoc.size() << " bytes." << std::endl;
     }
+    const std::vector<eidx_t> &rpao = (GL::ciaoFormat != CiaoFormat::RAW) ? rpaoc : gptr->rpao;
+    long ciaoUnit = (GL::ciaoFormat != CiaoFormat::RAW) ? 1 : (long)VertexProgram::getEdgeSize();
 
     auto alignMyself = [](long addr)->long{
         int bw = 8;
@@ -501,44 +672,154 @@ void MemWrapper::ramInit(const std::string &cfgFileName){
         return result;
     };
 
-    // Init memory
-    long depthAddr = GL::depthMemAddr = 0;
+    // Each partition is laid out as depth, rpao, ciao, rpai, ciai and 
+    // frontier, and the next partition starts right after it. The 
+    // frontier holds two queues of vNum vertices, which are read and 
+    // written in turn by the levels in sparse mode. The partitions are 
+    // assigned to the channels in round robin.
+    int channelNum = configs.get_channels();
+    std::vector<long> channelSize(channelNum, 0);
+    long len = GL::vertexNum / GL::peNum;
+    long addr = 0;
+    GL::partitions.resize(GL::peNum);
+    for(int p = 0; p < GL::peNum; p++){
+        Partition &part = GL::partitions[p];
+        part.vertexBegin = p * len;
+        part.vertexEnd = (p == GL::peNum - 1) ? GL::vertexNum : (p + 1) * len;
+        long vNum = part.vertexEnd - part.vertexBegin;
+        long ciaoLen = ciaoUnit * (rpao[part.vertexEnd] - rpao[part.vertexBegin]);
+        long ciaiLen = (long)sizeof(vidx_t) * (gptr->rpai[part.vertexEnd] - gptr->rpai[part.vertexBegin]);
+
+        part.baseAddr = addr;
+        part.depthMemAddr = addr;
+        long depthLen = (long)VertexProgram::getPropSize() * VertexProgram::getPropArrayNum() * vNum;
+        part.rpaoMemAddr = alignMyself(part.depthMemAddr + depthLen);
+        part.ciaoMemAddr = alignMyself(part.rpaoMemAddr + (long)sizeof(eidx_t) * (vNum + 1));
+        part.rpaiMemAddr = alignMyself(part.ciaoMemAddr + ciaoLen);
+        part.ciaiMemAddr = alignMyself(part.rpaiMemAddr + (long)sizeof(eidx_t) * (vNum + 1));
+        part.frontierMemAddr = alignMyself(part.ciaiMemAddr + ciaiLen);
+        part.frontierSize = 0;
+        part.endAddr = part.frontierMemAddr + (long)sizeof(vidx_t) * vNum * 2;
 
-    long rpaoAddr = depthAddr + (long)sizeof(signed char) * GL::vertexNum;
-    GL::rpaoMemAddr = rpaoAddr = alignMyself(rpaoAddr);
+        part.channel = p % channelNum;
+        part.channelBase = channelSize[part.channel];
+        addr = alignMyself(part.endAddr);
+        channelSize[part.channel] += addr - part.baseAddr;
+    }
 
-    long ciaoAddr = rpaoAddr + (long)sizeof(int) * (GL::vertexNum + 1);
-    GL::ciaoMemAddr = ciaoAddr = alignMyself(ciaoAddr);
+    // The memory image ends right after the last frontier slice.
+    ramData.resize(GL::partitions.back().endAddr);
 
-    long rpaiAddr = ciaoAddr + (long)sizeof(int) * GL::edgeNum;
-    GL::rpaiMemAddr = rpaiAddr = alignMyself(rpaiAddr);
+    // The row pointers of each partition start from 0.
+    auto getLocalRowPtr = [](const std::vector<eidx_t> &rp, const Partition &part){
+        std::vector<eidx_t> localRp(rp.begin() + part.vertexBegin, rp.begin() + part.vertexEnd + 1);
+        eidx_t base = localRp[0];
+        for(auto &ptr : localRp){
+            ptr -= base;
+        }
+        return localRp;
+    };
 
-    long ciaiAddr = rpaiAddr + (long)sizeof(int) * (GL::vertexNum + 1);
-    GL::ciaiMemAddr = ciaiAddr = alignMyself(ciaiAddr); 
+    // fill memory with the data
+    for(const auto &part : GL::partitions){
+        long vNum = part.vertexEnd - part.vertexBegin;
+        std::vector<eidx_t> localRpao = getLocalRowPtr(rpao, part);
+        std::vector<eidx_t> localRpai = getLocalRowPtr(gptr->rpai, part);
+        eidx_t outBegin = rpao[part.vertexBegin];
+        eidx_t inBegin = gptr->rpai[part.vertexBegin];
 
-    long frontierAddr = ciaiAddr + (long)sizeof(int) * GL::edgeNum;
-    GL::frontierMemAddr = frontierAddr = alignMyself(frontierAddr);
+        initProps(part);
+        fillRam(localRpao.data(), (long)localRpao.size(), part.rpaoMemAddr);
+        if(GL::ciaoFormat != CiaoFormat::RAW){
+            fillRam(ciaoc.data() + outBegin, (long)localRpao.back(), part.ciaoMemAddr);
+        }
+        else if(GL::algorithm == Algorithm::SSSP){
+            // Each neighbour is followed by the weight of the edge.
+            std::vector<vidx_t> weighted(localRpao.back() * 2);
+            for(vidx_t v = part.vertexBegin; v < part.vertexEnd; v++){
+                for(eidx_t e = rpao[v]; e < rpao[v + 1]; e++){
+                    vidx_t ngb = gptr->ciao[e];
+                    weighted[(e - outBegin) * 2] = ngb;
+                    weighted[(e - outBegin) * 2 + 1] = VertexProgram::getEdgeWeight(gptr->getOldId(v), gptr->getOldId(ngb));
+                }
+            }
+            fillRam(weighted.data(), (long)weighted.size(), part.ciaoMemAddr);
+        }
+        else{
+            fillRam(gptr->ciao.data() + outBegin, (long)localRpao.back(), part.ciaoMemAddr);
+        }
+        fillRam(localRpai.data(), (long)localRpai.size(), part.rpaiMemAddr);
+        fillRam(gptr->ciai.data() + inBegin, (long)localRpai.back(), part.ciaiMemAddr);
 
-    for(auto d : depth){
-        updateSingleDataToRam<signed char>(depthAddr, d);
-        depthAddr += (long)sizeof(signed char);
+        std::vector<vidx_t> frontier(vNum * 2, -1);
+        fillRam(frontier.data(), vNum * 2, part.frontierMemAddr);
     }
+}
 
-    // fill memory with the data
-    auto fillMem = [this](const std::vector<int> &vec, long &addr){
-        for(auto val : vec){
-            updateSingleDataToRam<int>(addr, val);
-            addr += (long)sizeof(int);
-        }
-    };
+// The partitions are laid out back to back in ramData, while each of 
+// them is mapped to its own channel in the DRAM. With the RoBaRaCoCh 
+// mapping of the memory model, the channel index takes the address bits 
+// right above the burst offset, and the offset in the channel is spread 
+// over the rest of the bits.
+long MemWrapper::getChannelAddr(long addr){
+    if(GL::peNum == 1){
+        return addr;
+    }
 
-    fillMem(rpao, rpaoAddr);
-    fillMem(ciao, ciaoAddr);
-    fillMem(rpai, rpaiAddr);
-    fillMem(ciai, ciaiAddr);
-    fillMem(frontier, frontierAddr);
+    auto it = std::upper_bound(GL::partitions.begin(), GL::partitions.end(), addr, 
+            [](long a, const Partition &part){ return a < part.baseAddr; });
+    const Partition &part = *(it - 1);
+    long offset = addr - part.baseAddr + part.channelBase;
+    long channelNum = configs.get_channels();
+    int bw = GL::burstAddrWidth;
+    long mask = (1L << bw) - 1;
+    return ((((offset >> bw) * channelNum) + part.channel) << bw) | (offset & mask);
 }
 
+// Each host thread encodes a continuous range of vertices to its own 
+// buffer, and the buffers are concatenated in the order of the ranges.
+void MemWrapper::compressCiao(
+        const Graph* gptr, 
+        std::vector<eidx_t> &rpaoc, 
+        std::vector<char> &ciaoc)
+{
+    int threadNum = GL::getHostThreadNum();
+    std::vector<std::vector<char>> buffers(threadNum);
+    rpaoc.resize(gptr->vertex_num + 1);
+    GL::parallelFor(0, gptr->vertex_num, [gptr, &rpaoc, &buffers](int tid, long begin, long end){
+        std::vector<vidx_t> ngbs;
+        for(long vidx = begin; vidx < end; vidx++){
+            rpaoc[vidx] = (eidx_t)buffers[tid].size();
+            ngbs.assign(gptr->ciao.begin() + gptr->rpao[vidx], gptr->ciao.begin() + gptr->rpao[vidx + 1]);
+            CiaoCodec::encode(GL::ciaoFormat, ngbs, buffers[tid]);
+        }
+    });
+
+    // Turn the offsets in each buffer to the offsets in ciaoc.
+    std::vector<long> bufferBase(threadNum + 1, 0);
+    for(int i = 0; i < threadNum; i++){
+        bufferBase[i + 1] = bufferBase[i] + (long)buffers[i].size();
+    }
+    if(bufferBase[threadNum] > (long)std::numeric_limits<eidx_t>::max()){
+        HERE;
+        std::cout << "Compressed ciao of " << bufferBase[threadNum];
+        std::cout << " bytes exceeds the index width. Rebuild with EIDX_BYTES=8." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    GL::parallelFor(0, gptr->vertex_num, [&rpaoc, &bufferBase](int tid, long begin, long end){
+        for(long vidx = begin; vidx < end; vidx++){
+            rpaoc[vidx] += (eidx_t)bufferBase[tid];
+        }
+    });
+    rpaoc[gptr->vertex_num] = (eidx_t)bufferBase[threadNum];
+
+    ciaoc.clear();
+    ciaoc.reserve(bufferBase[threadNum]);
+    for(int i = 0; i < threadNum; i++){
+        ciaoc.insert(ciaoc.end(), buffers[i].begin(), buffers[i].end());
+    }
+}
 
 void MemWrapper::dumpDepth(const std::string &fname){
     std::ofstream fhandle(fname.c_str());
@@ -548,20 +829,301 @@ void MemWrapper::dumpDepth(const std::string &fname){
         exit(EXIT_FAILURE);
     }
 
-    long addr = GL::depthMemAddr;
-    for(int i = 0; i < GL::vertexNum; i++){
-        fhandle << (int)(getSingleDataFromRam<char>(addr)) << std::endl;
-        addr += sizeof(char);
+    // The depth is dumped in the original vertex order.
+    for(long i = 0; i < GL::vertexNum; i++){
+        long addr = GL::getDepthMemAddr(graph->getNewId((vidx_t)i), VertexProgram::getResultSlot());
+        VertexProgram::printResult(fhandle, VertexProgram::getProp(&ramData[addr]));
+        fhandle << std::endl;
+    }
+}
+
+// The software bfs runs on the graph in the host memory, which is copied 
+// to ramData, from the same starting vertex. Each frontier vertex takes 
+// an rpao read on port 4 and each of its edges takes a depth read on 
+// port 6. The asynchronous bfs has no levels and may expand a vertex 
+// more than once, so only its depth is checked.
+void MemWrapper::verifyBfs(){
+    vidx_t root = graph->getNewId(GL::startingVertices[0]);
+    std::vector<int> depth(GL::vertexNum, -1);
+    std::vector<long> frontierSizes;
+    std::vector<vidx_t> frontier(1, root);
+    long expandedEdgeNum = 0;
+    long visitedNum = 0;
+    depth[root] = 0;
+    while(frontier.empty() == false){
+        std::vector<vidx_t> next;
+        frontierSizes.push_back((long)frontier.size());
+        for(auto v : frontier){
+            visitedNum++;
+            expandedEdgeNum += graph->getOutDeg(v);
+            for(eidx_t e = graph->rpao[v]; e < graph->rpao[v + 1]; e++){
+                vidx_t ngb = graph->ciao[e];
+                if(depth[ngb] == -1){
+                    depth[ngb] = depth[v] + 1;
+                    next.push_back(ngb);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+
+    long errNum = 0;
+    auto mismatch = [&errNum](const std::string &what, long expected, long actual){
+        if(errNum < 10){
+            std::cout << "BFS verification: " << what << " is " << actual;
+            std::cout << ", expected " << expected << std::endl;
+        }
+        errNum++;
+    };
+
+    // The depth is compared in the original vertex order.
+    for(long i = 0; i < GL::vertexNum; i++){
+        vidx_t v = graph->getNewId((vidx_t)i);
+        long simDepth = getSingleDataFromRam<signed char>(GL::getDepthMemAddr(v));
+        if(simDepth != depth[v]){
+            mismatch("depth of vertex " + std::to_string(i), depth[v], simDepth);
+        }
+    }
+
+    if(VertexProgram::isAsync() == false){
+        size_t levelNum = std::max(frontierSizes.size(), GL::frontierSizes.size());
+        for(size_t l = 0; l < levelNum; l++){
+            long expected = (l < frontierSizes.size()) ? frontierSizes[l] : 0;
+            long actual = (l < GL::frontierSizes.size()) ? GL::frontierSizes[l] : 0;
+            if(actual != expected){
+                mismatch("frontier size of level " + std::to_string(l), expected, actual);
+            }
+        }
+        if(portReadBurstNum[4] != visitedNum){
+            mismatch("# of rpao read bursts", visitedNum, portReadBurstNum[4]);
+        }
+        if(portReadBurstNum[6] != expandedEdgeNum){
+            mismatch("# of depth read bursts", expandedEdgeNum, portReadBurstNum[6]);
+        }
+    }
+
+    if(errNum > 0){
+        std::cout << "BFS verification fails with " << errNum << " mismatches." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "BFS verification passes: " << visitedNum << " vertices in ";
+    std::cout << frontierSizes.size() << " levels, " << depthWriteNum << " depth write bursts." << std::endl;
+}
+
+// Dijkstra on the graph in the host memory with the weights of 
+// VertexProgram, from the same starting vertex.
+void MemWrapper::verifySssp(){
+    vidx_t root = graph->getNewId(GL::startingVertices[0]);
+    std::vector<long> dist(GL::vertexNum, -1);
+    std::priority_queue<std::pair<long, vidx_t>, 
+        std::vector<std::pair<long, vidx_t>>, 
+        std::greater<std::pair<long, vidx_t>>> heap;
+    dist[root] = 0;
+    heap.push(std::make_pair(0L, root));
+    while(heap.empty() == false){
+        long d = heap.top().first;
+        vidx_t v = heap.top().second;
+        heap.pop();
+        if(d != dist[v]){
+            continue;
+        }
+        for(eidx_t e = graph->rpao[v]; e < graph->rpao[v + 1]; e++){
+            vidx_t ngb = graph->ciao[e];
+            long nd = d + VertexProgram::getEdgeWeight(graph->getOldId(v), graph->getOldId(ngb));
+            if(dist[ngb] == -1 || nd < dist[ngb]){
+                dist[ngb] = nd;
+                heap.push(std::make_pair(nd, ngb));
+            }
+        }
+    }
+
+    long errNum = 0;
+    for(long i = 0; i < GL::vertexNum; i++){
+        vidx_t v = graph->getNewId((vidx_t)i);
+        long simDist = VertexProgram::getProp(&ramData[GL::getDepthMemAddr(v)]);
+        if(simDist != dist[v]){
+            if(errNum < 10){
+                std::cout << "SSSP verification: distance of vertex " << i << " is ";
+                std::cout << simDist << ", expected " << dist[v] << std::endl;
+            }
+            errNum++;
+        }
+    }
+    if(errNum > 0){
+        std::cout << "SSSP verification fails with " << errNum << " mismatches." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "SSSP verification passes." << std::endl;
+}
+
+// PageRank in double precision on the graph in the host memory, with the 
+// same damping factor and # of iterations, and the rank of the vertices 
+// without outgoing edges dropped. The fixed point ranks of the simulation 
+// must agree to 1e-6 of the rank, or of 1 / N for the smaller ranks.
+void MemWrapper::verifyPageRank(){
+    long vNum = GL::vertexNum;
+    std::vector<double> rank(vNum, 1.0 / vNum);
+    std::vector<double> acc(vNum);
+    for(int iter = 0; iter < GL::pageRankIterNum; iter++){
+        std::fill(acc.begin(), acc.end(), 0.0);
+        for(long v = 0; v < vNum; v++){
+            long degree = graph->getOutDeg((vidx_t)v);
+            for(eidx_t e = graph->rpao[v]; e < graph->rpao[v + 1]; e++){
+                acc[graph->ciao[e]] += rank[v] / degree;
+            }
+        }
+        for(long v = 0; v < vNum; v++){
+            rank[v] = 0.15 / vNum + 0.85 * acc[v];
+        }
+    }
+
+    long errNum = 0;
+    double maxErr = 0;
+    int slot = VertexProgram::getResultSlot();
+    for(long i = 0; i < vNum; i++){
+        vidx_t v = graph->getNewId((vidx_t)i);
+        double simRank = VertexProgram::getPageRank(VertexProgram::getProp(&ramData[GL::getDepthMemAddr(v, slot)]));
+        double err = std::fabs(simRank - rank[v]) / std::max(rank[v], 1.0 / vNum);
+        maxErr = std::max(maxErr, err);
+        if(err > 1e-6){
+            if(errNum < 10){
+                std::cout << "PageRank verification: rank of vertex " << i << " is ";
+                std::cout << simRank << ", expected " << rank[v] << std::endl;
+            }
+            errNum++;
+        }
+    }
+    if(errNum > 0){
+        std::cout << "PageRank verification fails with " << errNum << " mismatches." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "PageRank verification passes, max relative error " << maxErr << "." << std::endl;
+}
+
+// All the arrays of the properties start from the initial property.
+void MemWrapper::initProps(const Partition &part){
+    if(GL::algorithm == Algorithm::BFS){
+        long vNum = part.vertexEnd - part.vertexBegin;
+        std::fill(&ramData[part.depthMemAddr], &ramData[part.depthMemAddr] + vNum, (char)-1);
+        return;
+    }
+    for(int slot = 0; slot < VertexProgram::getPropArrayNum(); slot++){
+        for(vidx_t v = part.vertexBegin; v < part.vertexEnd; v++){
+            VertexProgram::setProp(&ramData[GL::getDepthMemAddr(v, slot)], VertexProgram::getInitProp(v));
+        }
     }
 }
 
 void MemWrapper::statusMonitor(){
     while(true){
         if(bfsDone.read()){
-            dumpDepth("./depth.txt");
+            if(GL::depthDumpFile.empty() == false){
+                dumpDepth(GL::depthDumpFile);
+            }
+            if(GL::verifyBfs != 0 && GL::algorithm == Algorithm::SSSP){
+                verifySssp();
+            }
+            else if(GL::verifyBfs != 0 && GL::algorithm == Algorithm::PAGERANK){
+                verifyPageRank();
+            }
+            else if(GL::verifyBfs != 0){
+                verifyBfs();
+            }
+            reportPortStats();
+            reportEnergy();
+            if(GL::logon != 0){
+                std::cout << "skipped idle memory cycles: " << skippedCycles << std::endl;
+            }
             std::cout << "Simulation completes." << std::endl;
             sc_stop();
         }
         wait(peClkCycle, SC_NS);
     }
 }
+
+// The energy counters are accumulated in the memory controllers while
+// the commands are issued, so it is only collected and reported here.
+void MemWrapper::reportEnergy(){
+    if(!getMemEnergy){
+        return;
+    }
+
+    EnergyBreakdown e = getMemEnergy();
+    GL::memEnergy = e.total() * 1e-12;
+    std::cout << "DRAM energy: " << GL::memEnergy << " J" << std::endl;
+    if(GL::logon != 0){
+        std::cout << "    activation: " << e.act * 1e-12 << " J" << std::endl;
+        std::cout << "    precharge: " << e.pre * 1e-12 << " J" << std::endl;
+        std::cout << "    read: " << e.rd * 1e-12 << " J" << std::endl;
+        std::cout << "    write: " << e.wr * 1e-12 << " J" << std::endl;
+        std::cout << "    refresh: " << e.ref * 1e-12 << " J" << std::endl;
+        std::cout << "    background: " << e.background * 1e-12 << " J" << std::endl;
+    }
+    if(GL::bfsRuntime > 0){
+        std::cout << "DRAM average power: " << e.total() / GL::bfsRuntime << " W" << std::endl;
+    }
+    std::cout << "DRAM energy per traversed edge: " << GL::memEnergy / GL::edgeNum << " J" << std::endl;
+}
+
+// The bandwidth share is the fraction of the memory requests sent from 
+// each pe port, and the p50 and p99 burst latency are reported. The same 
+// ports of all the pes are counted together.
+void MemWrapper::reportPortStats(){
+    long totalReqNum = 0;
+    for(auto num : portReqNum){
+        totalReqNum += num;
+    }
+    if(totalReqNum == 0){
+        return;
+    }
+
+    for(int p = 0; p < PNUM; p++){
+        if(portLatency[p].getCount() == 0){
+            continue;
+        }
+        std::cout << "port " << p << ": ";
+        std::cout << "share " << 100.0 * portReqNum[p] / totalReqNum << "%, ";
+        std::cout << "latency p50 " << portLatency[p].getPercentile(0.5) / 1000.0 << " ns, ";
+        std::cout << "p99 " << portLatency[p].getPercentile(0.99) / 1000.0 << " ns" << std::endl;
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : buckets(bucketNum, 0), count(0){}
+
+void LatencyHistogram::add(long latency){
+    buckets[getBucket(std::max(latency, 0L))]++;
+    count++;
+}
+
+long LatencyHistogram::getPercentile(double q) const {
+    long rank = std::max(1L, (long)std::ceil(q * count));
+    long sum = 0;
+    for(int b = 0; b < bucketNum; b++){
+        sum += buckets[b];
+        if(sum >= rank){
+            return getUpperBound(b);
+        }
+    }
+    return getUpperBound(bucketNum - 1);
+}
+
+// The latencies below 2^subBits have a bucket each. The latency of 
+// bits e + 1 goes to the sub-bucket of its subBits bits below the 
+// leading one, in the bucket of e.
+int LatencyHistogram::getBucket(long latency){
+    if(latency < (1L << subBits)){
+        return (int)latency;
+    }
+    int e = 63 - __builtin_clzl((unsigned long)latency);
+    int sub = (int)((latency >> (e - subBits)) & ((1L << subBits) - 1));
+    return ((e - subBits + 1) << subBits) + sub;
+}
+
+long LatencyHistogram::getUpperBound(int bucket){
+    if(bucket < (1 << subBits)){
+        return bucket;
+    }
+    int shift = (bucket >> subBits) - 1;
+    long lower = ((1L << subBits) + (bucket & ((1 << subBits) - 1))) << shift;
+    return lower + (1L << shift) - 1;
+}
@@ -18,8 +18,13 @@
 #include <list>
 #include <vector>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <cmath>
 #include "common.h"
 #include "graph.h"
+#include "codec.h"
+#include "arbiter.h"
 #include <ctime>
 
 /* Standards */
@@ -37,6 +42,28 @@
 #include "ALDRAM.h"
 #include "TLDRAM.h"
 
+// Histogram of the burst latencies in ps. The latencies are put in log2 
+// buckets, each split into 8 linear sub-buckets, so the memory is fixed 
+// and a percentile is found within 1/8 of the latency.
+class LatencyHistogram{
+    public:
+        LatencyHistogram();
+        void add(long latency);
+        long getCount() const { return count; }
+
+        // The upper bound of the sub-bucket that holds the q quantile.
+        long getPercentile(double q) const;
+
+    private:
+        static const int subBits = 3;
+        static const int bucketNum = (64 - subBits) << subBits;
+        std::vector<long> buckets;
+        long count;
+
+        static int getBucket(long latency);
+        static long getUpperBound(int bucket);
+};
+
 class MemWrapper : public sc_module{
 
     SC_HAS_PROCESS(MemWrapper);
@@ -50,8 +77,11 @@ class MemWrapper : public sc_module{
         std::vector<const char*> files;
 
         // Signals from/to pes. They will be processed following the peClk.
-        sc_in <long> burstReq[PNUM];
-        sc_out <long> burstResp[PNUM];
+        // The ports of pe i are [i * PNUM, (i + 1) * PNUM).
+        int portNum;
+        sc_in <long>* burstReq;
+        sc_out <long>* burstResp;
+        sc_out <long>* reqCredit;
         sc_in <bool> bfsDone;
 
         // In addition, as the requests are stored in order, 
@@ -62,11 +92,32 @@ class MemWrapper : public sc_module{
         // be gradually removed when the response is sent out.
         std::vector<std::list<long>> burstRespQueue;
 
-        // It stores all the requests to be sent to the ramulator
+        // It stores all the requests to be sent to the ramulator per port.
         // It will gradually be removed when it is processed.
         // It also helps with the synchronization between 
         // the mem clock domain and the pe clock domain.
-        std::list<Request> reqQueue; 
+        std::vector<std::list<Request>> reqQueue; 
+        PortArbiter* arbiter;
+
+        // Credits of the requests that left reqQueue in the current pe 
+        // cycle. They are returned to the pe ports on reqCredit.
+        std::vector<long> freedCredit;
+
+        // Notified when new requests are queued, which wakes up the 
+        // memory simulation skipping the idle memory cycles.
+        sc_event reqArrival;
+        long skippedCycles;
+
+        // # of memory requests sent, and the histogram of the burst 
+        // latency from the pe request to the response of each pe port.
+        std::vector<long> portReqNum;
+        std::vector<LatencyHistogram> portLatency;
+
+        // # of read and write bursts served on each pe port, and the 
+        // write bursts among them that update the depth.
+        std::vector<long> portReadBurstNum;
+        std::vector<long> portWriteBurstNum;
+        long depthWriteNum;
 
         double findTime;
         double removeTime;
@@ -90,10 +141,19 @@ class MemWrapper : public sc_module{
         void memReqMonitor();
         void respMonitor();
         void cleanRam(); // clean the ram content for new bfs traverse
-        void setNewStartVertex(int idx); // set ram for a different start vertices of bfs.
+        void setNewStartVertex(vidx_t idx); // set ram for a different start vertices of bfs.
         void statusMonitor();
         void sigInit();
-        ~MemWrapper(){};
+        ~MemWrapper(){
+            delete[] burstReq;
+            delete[] burstResp;
+            delete[] reqCredit;
+            delete arbiter;
+        };
+
+        // The graph is loaded only once per process. Simulations forked 
+        // after the loading, e.g. the sweep points, share the same graph.
+        static Graph* loadGraph(const std::string &cfgFileName);
 
         // Get data from ram.
         template<typename T>
@@ -118,16 +178,40 @@ class MemWrapper : public sc_module{
 
         double memClkCycle;
         double peClkCycle;
+        double specClkCycle; // tCK of the memory standard in ns
+
+        static Graph* graph;
+
+        // The memory model is created in the memory simulation thread, 
+        // and it is probed through this function for the energy report.
+        std::function<EnergyBreakdown()> getMemEnergy;
 
         void loadConfig(int argc, char* argv[]);
-        Graph* loadGraph(const std::string &cfgFileName);
-        int calBurstLen();
+        void cfgSpecParam();
+
+        template<typename T>
+        void getSpecParam(T* spec){
+            GL::setBurstLen(spec->prefetch_size * spec->channel_width / 8);
+            specClkCycle = spec->speed_entry.tCK;
+            delete spec;
+        }
         long getMaxDepartTime(const std::vector<long> &reqVec);
         long getMinArriveTime(const std::vector<long> &reqVec);
         void cleanProcessedRequests(long idx);
         void shallowReqCopy(const Request &simpleReq, Request &req);
         void ramInit(const std::string &cfgFileName);
+        long getChannelAddr(long addr);
+        void compressCiao(
+                const Graph* gptr, 
+                std::vector<eidx_t> &rpaoc, 
+                std::vector<char> &ciaoc);
         void dumpDepth(const std::string &fname);
+        void verifyBfs();
+        void verifySssp();
+        void verifyPageRank();
+        void initProps(const Partition &part);
+        void reportEnergy();
+        void reportPortStats();
         bool updateWriteResp();
 
         // Update ram on a specified addr with specified data type.
@@ -142,6 +226,17 @@ class MemWrapper : public sc_module{
             }
         }
 
+        // Copy num elements to ram starting from addr. They are copied 
+        // by the host threads in parallel as the arrays can be large.
+        template <typename T>
+        void fillRam(const T* data, long num, long addr){
+            GL::parallelFor(0, num, [this, data, addr](int tid, long begin, long end){
+                if(begin < end){
+                    memcpy(&ramData[addr + begin * sizeof(T)], data + begin, (end - begin) * sizeof(T));
+                }
+            });
+        }
+
 };
 
 #endif 
@@ -18,6 +18,7 @@
 #include <cmath>
 #include <cassert>
 #include <tuple>
+#include <climits>
 
 using namespace std;
 
@@ -281,6 +282,24 @@ public:
         }
     }
 
+    // # of the following cycles in which all the controllers are idle,
+    // see Controller::get_idle_cycles().
+    long get_idle_cycles()
+    {
+        long cycles = LONG_MAX;
+        for (auto ctrl : ctrls)
+            cycles = min(cycles, ctrl->get_idle_cycles());
+        return cycles;
+    }
+
+    // Same as cycles calls of tick() when they are idle.
+    void skip_idle(long cycles)
+    {
+        num_dram_cycles += cycles;
+        for (auto ctrl : ctrls)
+            ctrl->skip_idle(cycles);
+    }
+
     bool send(Request req)
     {
         req.addr_vec.resize(addr_bits.size());
@@ -323,14 +342,40 @@ public:
         return false;
     }
 
+    // Channel of an address, decoded in the same way as in send
+    int get_channel(long addr)
+    {
+        clear_lower_bits(addr, tx_bits);
+        if (type == Type::ChRaBaRoCo) {
+            for (int i = addr_bits.size() - 1; i > 0; i--)
+                slice_lower_bits(addr, addr_bits[i]);
+        }
+        return slice_lower_bits(addr, addr_bits[0]);
+    }
+
     int pending_requests()
     {
         int reqs = 0;
         for (auto ctrl: ctrls)
-            reqs += ctrl->readq.size() + ctrl->writeq.size() + ctrl->otherq.size() + ctrl->pending.size();
+            reqs += ctrl->readq.size() + ctrl->writeq.size() + ctrl->otherq.size() + ctrl->pending.size() + ctrl->pending_writes.size();
         return reqs;
     }
 
+    EnergyBreakdown get_energy()
+    {
+        EnergyBreakdown e;
+        for (auto ctrl: ctrls) {
+            EnergyBreakdown c = ctrl->energy->get_breakdown();
+            e.act += c.act;
+            e.pre += c.pre;
+            e.rd += c.rd;
+            e.wr += c.wr;
+            e.ref += c.ref;
+            e.background += c.background;
+        }
+        return e;
+    }
+
     void finish(void) {
       dram_capacity = max_address;
       int *sz = spec->org_entry.count;
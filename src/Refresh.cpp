@@ -250,6 +250,11 @@ void Refresh<DSARP>::tick_ref() {
   if ((clk - refreshed) >= refresh_interval)
     inject_refresh(b_ref_rank);
 }
+
+template<>
+long Refresh<DSARP>::get_idle_cycles() {
+  return 0;
+}
 /**** End DSARP specialization ****/
 
 } /* namespace ramulator */
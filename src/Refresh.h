@@ -83,6 +83,16 @@ public:
     }
   }
 
+  // # of the following ticks that don't inject a refresh
+  long get_idle_cycles() {
+    int refresh_interval = ctrl->channel->spec->speed_entry.nREFI;
+    return max(refreshed + refresh_interval - clk - 1, 0L);
+  }
+
+  void skip_idle(long cycles) {
+    clk += cycles;
+  }
+
 private:
   // Keeping track of refresh status of every bank: + means ahead of schedule, - means behind schedule
   vector<vector<int>*> bank_refresh_backlog;
@@ -132,6 +142,8 @@ private:
 // where to look for these definitions when controller calls them!
 template<> Refresh<DSARP>::Refresh(Controller<DSARP>* ctrl);
 template<> void Refresh<DSARP>::tick_ref();
+// DSARP may inject refreshes early, so the ticks are never skipped.
+template<> long Refresh<DSARP>::get_idle_cycles();
 
 } /* namespace ramulator */
 
@@ -0,0 +1,256 @@
+#include "Sweep.h"
+#include "MemWrapper.h"
+#include <map>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+Sweep::Sweep(
+        const std::string &sweepFileName,
+        const std::string &memCfgFileName)
+{
+    jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    outputFileName = "./sweep-result.txt";
+    loadSweepFile(sweepFileName);
+
+    // The memory configuration on the command line is used
+    // when it is not swept.
+    if(std::find(keys.begin(), keys.end(), "memConfig") == keys.end()){
+        keys.insert(keys.begin(), "memConfig");
+        vals.insert(vals.begin(), std::vector<std::string>{memCfgFileName});
+    }
+
+    createPoints();
+}
+
+void Sweep::loadSweepFile(const std::string &sweepFileName){
+    std::ifstream fhandle(sweepFileName.c_str());
+    if(!fhandle.is_open()){
+        HERE;
+        std::cout << "Failed to open " << sweepFileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    while(std::getline(fhandle, line)){
+        std::istringstream iss(line);
+        std::string key;
+        if(!(iss >> key) || key[0] == '#'){
+            continue;
+        }
+
+        std::vector<std::string> keyVals(
+                (std::istream_iterator<std::string>(iss)),
+                std::istream_iterator<std::string>());
+        if(keyVals.empty()){
+            HERE;
+            std::cout << "No value is specified for " << key << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if(key == "jobs"){
+            jobs = std::stoi(keyVals[0]);
+        }
+        else if(key == "output"){
+            outputFileName = keyVals[0];
+        }
+        else{
+            keys.push_back(key);
+            vals.push_back(keyVals);
+        }
+    }
+    fhandle.close();
+
+    if(jobs < 1){
+        jobs = 1;
+    }
+}
+
+// Cartesian product of all the swept values. The last key changes fastest.
+void Sweep::createPoints(){
+    std::vector<int> idx(keys.size(), 0);
+    while(true){
+        Point point;
+        for(size_t i = 0; i < keys.size(); i++){
+            point.push_back(std::make_pair(keys[i], vals[i][idx[i]]));
+        }
+        points.push_back(point);
+
+        int k = (int)keys.size() - 1;
+        while(k >= 0){
+            idx[k]++;
+            if(idx[k] < (int)vals[k].size()){
+                break;
+            }
+            idx[k] = 0;
+            k--;
+        }
+
+        if(k < 0){
+            break;
+        }
+    }
+}
+
+// It is executed in the child process. The simulation log is redirected
+// to a file per point such that the console is not messed up by the
+// points running at the same time.
+std::string Sweep::runPoint(
+        int pointIdx,
+        const std::string &progName,
+        int (*simulate)(int argc, char* argv[]))
+{
+    std::string logName = outputFileName + "." + std::to_string(pointIdx) + ".log";
+    if(freopen(logName.c_str(), "w", stdout) == NULL){
+        HERE;
+        std::cout << "Failed to open " << logName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string memCfgFileName;
+    for(const auto &kv : points[pointIdx]){
+        if(kv.first == "memConfig"){
+            memCfgFileName = kv.second;
+        }
+        else if(!GL::setBfsParam(kv.first, kv.second)){
+            HERE;
+            std::cout << "Unknown sweep parameter " << kv.first << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Multiple points may run at the same time and the depth dump
+    // must not be overwritten by each other.
+    GL::depthDumpFile = "";
+
+    std::vector<std::string> args{progName, memCfgFileName, "--mode=acc", "dram.trace"};
+    std::vector<char*> argv;
+    for(auto &arg : args){
+        argv.push_back(&arg[0]);
+    }
+    simulate((int)argv.size(), argv.data());
+
+    std::ostringstream oss;
+    oss << pointIdx;
+    for(const auto &kv : points[pointIdx]){
+        oss << "\t" << kv.second;
+    }
+    double runtime = GL::bfsRuntime/1000;
+    oss << "\t" << GL::bfsRuntime;
+    oss << "\t" << GL::edgeNum/runtime;
+    oss << "\t" << GL::memEnergy;
+    oss << "\t" << GL::memEnergy/GL::edgeNum;
+    oss << "\t" << GL::ciaoReadBytes;
+    oss << "\t" << GL::ciaoDecodeCycles;
+
+    return oss.str();
+}
+
+int Sweep::run(
+        const std::string &progName,
+        int (*simulate)(int argc, char* argv[]))
+{
+    // Load the graph before forking, so it is parsed only once.
+    MemWrapper::loadGraph("./config.txt");
+    std::cout << "Sweep " << points.size() << " points with ";
+    std::cout << jobs << " jobs." << std::endl;
+
+    std::vector<std::string> rows(points.size());
+    std::map<pid_t, std::pair<int, int>> running; // pid -> (pointIdx, pipe fd)
+    int nextIdx = 0;
+    int failNum = 0;
+
+    while(nextIdx < (int)points.size() || running.empty() == false){
+        if(nextIdx < (int)points.size() && (int)running.size() < jobs){
+            int fd[2];
+            if(pipe(fd) != 0){
+                HERE;
+                std::cout << "Failed to create pipe." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            std::cout.flush();
+            pid_t pid = fork();
+            if(pid < 0){
+                HERE;
+                std::cout << "Failed to fork sweep point " << nextIdx << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            else if(pid == 0){
+                close(fd[0]);
+                std::string row = runPoint(nextIdx, progName, simulate);
+                if(write(fd[1], row.c_str(), row.size()) != (ssize_t)row.size()){
+                    _exit(EXIT_FAILURE);
+                }
+                close(fd[1]);
+                std::cout.flush();
+                fflush(stdout);
+                _exit(EXIT_SUCCESS);
+            }
+
+            close(fd[1]);
+            running[pid] = std::make_pair(nextIdx, fd[0]);
+            nextIdx++;
+            continue;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if(pid < 0 || running.find(pid) == running.end()){
+            continue;
+        }
+
+        int pointIdx = running[pid].first;
+        int fd = running[pid].second;
+        running.erase(pid);
+
+        std::string row;
+        char buf[1024];
+        ssize_t len;
+        while((len = read(fd, buf, sizeof(buf))) > 0){
+            row.append(buf, len);
+        }
+        close(fd);
+
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || row.empty()){
+            failNum++;
+            row = std::to_string(pointIdx);
+            for(const auto &kv : points[pointIdx]){
+                row += "\t" + kv.second;
+            }
+            row += "\tfailed\tfailed\tfailed\tfailed\tfailed\tfailed";
+        }
+
+        rows[pointIdx] = row;
+        std::cout << "Sweep point " << pointIdx << " is done." << std::endl;
+    }
+
+    dumpTable(rows);
+
+    return failNum == 0 ? 0 : EXIT_FAILURE;
+}
+
+void Sweep::dumpTable(const std::vector<std::string> &rows){
+    std::ofstream fhandle(outputFileName.c_str());
+    if(!fhandle.is_open()){
+        HERE;
+        std::cout << "Failed to open " << outputFileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::ostringstream header;
+    header << "point";
+    for(const auto &key : keys){
+        header << "\t" << key;
+    }
+    header << "\truntime(ps)\tgteps\tenergy(J)\tenergy/edge(J)\tciao(bytes)\tdecode(cycles)";
+
+    fhandle << header.str() << std::endl;
+    std::cout << header.str() << std::endl;
+    for(const auto &row : rows){
+        fhandle << row << std::endl;
+        std::cout << row << std::endl;
+    }
+    fhandle.close();
+}
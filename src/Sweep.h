@@ -0,0 +1,51 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "common.h"
+
+// ----------------------------------------------------------------------------
+// Parameter sweep driver. The graph is loaded once in the parent process and
+// each configuration point is simulated in a forked child process, which
+// shares the loaded graph through copy-on-write. SystemC can only be
+// elaborated once per process, so forking is also the natural way to run
+// the independent points in parallel. Each child sends a single result row
+// back through a pipe and the parent writes all the rows into one table.
+//
+// The sweep file consists of lines like "key val0 val1 ...", and the
+// simulated points are the cartesian product of all the listed values.
+// Keys are the same as the ones in config.txt, plus the following ones:
+//   memConfig  ramulator configuration file, e.g. configs/HBM-config.cfg
+//   jobs       number of points simulated at the same time
+//   output     file name of the consolidated result table
+// ----------------------------------------------------------------------------
+class Sweep{
+
+    public:
+        typedef std::vector<std::pair<std::string, std::string>> Point;
+
+        Sweep(const std::string &sweepFileName, const std::string &memCfgFileName);
+
+        // simulate() runs a single accelerator simulation with the same
+        // arguments as the ramulator command line.
+        int run(const std::string &progName, int (*simulate)(int argc, char* argv[]));
+
+    private:
+        int jobs;
+        std::string outputFileName;
+        std::vector<std::string> keys;
+        std::vector<std::vector<std::string>> vals;
+        std::vector<Point> points;
+
+        void loadSweepFile(const std::string &sweepFileName);
+        void createPoints();
+        std::string runPoint(
+                int pointIdx,
+                const std::string &progName,
+                int (*simulate)(int argc, char* argv[]));
+        void dumpTable(const std::vector<std::string> &rows);
+};
+
+#endif
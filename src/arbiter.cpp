@@ -0,0 +1,116 @@
+#include "arbiter.h"
+
+PortArbiter::PortArbiter(int _portNum){
+    portNum = _portNum;
+    cur = portNum - 1;
+    served = 0;
+    burstReqNum.resize(portNum);
+    burstLeft.resize(portNum, 0);
+    deficit.resize(portNum, 0);
+}
+
+void PortArbiter::push(int port, int reqNum){
+    if(GL::arbiterPolicy == ArbiterPolicy::FIFO){
+        arrivalOrder.insert(arrivalOrder.end(), reqNum, port);
+    }
+    else if(GL::arbiterPolicy == ArbiterPolicy::DRR){
+        burstReqNum[port].push_back(reqNum);
+    }
+}
+
+// The first non-empty port starting from port from.
+int PortArbiter::getNextPort(
+        const std::vector<std::list<ramulator::Request>> &queues,
+        int from)
+{
+    for(int i = 0; i < portNum; i++){
+        int port = (from + i) % portNum;
+        if(queues[port].empty() == false){
+            return port;
+        }
+    }
+    return -1;
+}
+
+int PortArbiter::pick(const std::vector<std::list<ramulator::Request>> &queues){
+    if(GL::arbiterPolicy == ArbiterPolicy::FIFO){
+        if(arrivalOrder.empty()){
+            return -1;
+        }
+        int port = arrivalOrder.front();
+        arrivalOrder.pop_front();
+        return port;
+    }
+    else if(GL::arbiterPolicy == ArbiterPolicy::PRIORITY){
+        return pickPriority(queues);
+    }
+    else if(GL::arbiterPolicy == ArbiterPolicy::DRR){
+        return pickDrr(queues);
+    }
+
+    int weight = 1;
+    if(GL::arbiterPolicy == ArbiterPolicy::WEIGHTED){
+        weight = GL::portWeight[cur % PNUM];
+    }
+    if(served < weight && queues[cur].empty() == false){
+        served++;
+        return cur;
+    }
+
+    int port = getNextPort(queues, cur + 1);
+    if(port != -1){
+        cur = port;
+        served = 1;
+    }
+    return port;
+}
+
+int PortArbiter::pickPriority(const std::vector<std::list<ramulator::Request>> &queues){
+    int port = -1;
+    for(int i = 1; i <= portNum; i++){
+        int p = (cur + i) % portNum;
+        if(queues[p].empty()){
+            continue;
+        }
+        if(port == -1 || GL::portPriority[p % PNUM] > GL::portPriority[port % PNUM]){
+            port = p;
+        }
+    }
+    if(port != -1){
+        cur = port;
+    }
+    return port;
+}
+
+// The port keeps sending till its current burst is done. Then it starts
+// the next burst when the deficit covers it, or the turn moves on and the
+// next non-empty port earns its quantum. The deficit of an empty port is
+// cleared.
+int PortArbiter::pickDrr(const std::vector<std::list<ramulator::Request>> &queues){
+    if(getNextPort(queues, 0) == -1){
+        return -1;
+    }
+
+    while(true){
+        if(burstLeft[cur] > 0){
+            burstLeft[cur]--;
+            return cur;
+        }
+
+        if(queues[cur].empty()){
+            deficit[cur] = 0;
+        }
+        else{
+            long cost = (long)burstReqNum[cur].front() * GL::burstLen;
+            if(deficit[cur] >= cost){
+                deficit[cur] -= cost;
+                burstLeft[cur] = burstReqNum[cur].front() - 1;
+                burstReqNum[cur].pop_front();
+                return cur;
+            }
+        }
+
+        cur = getNextPort(queues, cur + 1);
+        deficit[cur] += (long)GL::portWeight[cur % PNUM] * GL::drrQuantum;
+    }
+}
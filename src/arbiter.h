@@ -0,0 +1,52 @@
+#ifndef __ARBITER_H__
+#define __ARBITER_H__
+
+#include <list>
+#include <vector>
+#include "Request.h"
+#include "common.h"
+
+// Arbiter between the pe ports in front of the memory controllers. Each
+// port has its own request queue, and one request is sent to the memory
+// per memory cycle from the port picked with GL::arbiterPolicy.
+//   fifo      the requests are sent in the order they arrive
+//   rr        the non-empty ports take turns, one request per turn
+//   weighted  a port sends up to portWeight requests per turn
+//   priority  the port with the highest portPriority is served first,
+//             and the ports of the same priority take turns
+//   drr       deficit round robin over the bursts. A port earns
+//             portWeight * drrQuantum bytes per turn and a burst is sent
+//             without interruption once its cost is covered.
+// The weight and the priority are set per pe port and shared by the pes.
+class PortArbiter{
+    public:
+        PortArbiter(int _portNum);
+
+        // A burst of reqNum requests is queued on port.
+        void push(int port, int reqNum);
+
+        // Port of the next request to be sent. The request must be
+        // removed from the queue. It returns -1 when all the queues
+        // are empty.
+        int pick(const std::vector<std::list<ramulator::Request>> &queues);
+
+    private:
+        int portNum;
+        int cur;         // port of the current turn
+        int served;      // # of requests sent in the current turn
+
+        // Ports of the queued requests in the arrival order (fifo).
+        std::list<int> arrivalOrder;
+
+        // Request number of the queued bursts, the requests left in the
+        // burst being sent and the deficit in bytes of each port (drr).
+        std::vector<std::list<int>> burstReqNum;
+        std::vector<int> burstLeft;
+        std::vector<long> deficit;
+
+        int getNextPort(const std::vector<std::list<ramulator::Request>> &queues, int from);
+        int pickPriority(const std::vector<std::list<ramulator::Request>> &queues);
+        int pickDrr(const std::vector<std::list<ramulator::Request>> &queues);
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "codec.h"
+#include <algorithm>
+
+CiaoCodec::CiaoCodec(){
+    format = CiaoFormat::VARINT;
+    stage = Stage::FIRST;
+    remainingLen = 0;
+    prev = 0;
+    acc = 0;
+    shift = 0;
+    gapNum = 0;
+    width = 0;
+    bitBuf = 0;
+    bitNum = 0;
+}
+
+void CiaoCodec::putVarint(uint64_t val, std::vector<char> &out){
+    while(val >= 0x80){
+        out.push_back((char)((val & 0x7F) | 0x80));
+        val >>= 7;
+    }
+    out.push_back((char)val);
+}
+
+void CiaoCodec::encode(
+        CiaoFormat format,
+        std::vector<vidx_t> &ngbs,
+        std::vector<char> &out)
+{
+    if(ngbs.empty()){
+        return;
+    }
+
+    std::sort(ngbs.begin(), ngbs.end());
+    putVarint((uint64_t)ngbs[0], out);
+    if(format == CiaoFormat::VARINT){
+        for(size_t i = 1; i < ngbs.size(); i++){
+            putVarint((uint64_t)(ngbs[i] - ngbs[i - 1]), out);
+        }
+        return;
+    }
+
+    uint64_t maxGap = 0;
+    for(size_t i = 1; i < ngbs.size(); i++){
+        maxGap = std::max(maxGap, (uint64_t)(ngbs[i] - ngbs[i - 1]));
+    }
+    int gapWidth = 0;
+    while(gapWidth < 64 && (maxGap >> gapWidth) != 0){
+        gapWidth++;
+    }
+
+    putVarint(ngbs.size() - 1, out);
+    out.push_back((char)gapWidth);
+
+    // The gaps are packed through a 64-bit buffer, which holds up to
+    // gapWidth + 7 bits. The widths beyond 56 bits can't be reached
+    // by the vertex indices in practice.
+    uint64_t buf = 0;
+    int bits = 0;
+    for(size_t i = 1; i < ngbs.size(); i++){
+        buf |= (uint64_t)(ngbs[i] - ngbs[i - 1]) << bits;
+        bits += gapWidth;
+        while(bits >= 8){
+            out.push_back((char)(buf & 0xFF));
+            buf >>= 8;
+            bits -= 8;
+        }
+    }
+    if(bits > 0){
+        out.push_back((char)(buf & 0xFF));
+    }
+}
+
+void CiaoCodec::start(CiaoFormat _format, long len){
+    format = _format;
+    stage = Stage::FIRST;
+    remainingLen = len;
+    acc = 0;
+    shift = 0;
+    bitBuf = 0;
+    bitNum = 0;
+}
+
+void CiaoCodec::decodeByte(uint8_t byte, std::list<vidx_t> &out){
+    remainingLen--;
+
+    if(stage == Stage::WIDTH){
+        width = byte;
+        stage = Stage::GAPS;
+        for(; width == 0 && gapNum > 0; gapNum--){
+            out.push_back(prev);
+        }
+        return;
+    }
+
+    if(stage == Stage::GAPS && format == CiaoFormat::BITPACK){
+        bitBuf |= (uint64_t)byte << bitNum;
+        bitNum += 8;
+        uint64_t mask = (width >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << width) - 1);
+        for(; gapNum > 0 && bitNum >= width; gapNum--){
+            prev += (vidx_t)(bitBuf & mask);
+            out.push_back(prev);
+            bitBuf = (width >= 64) ? 0 : (bitBuf >> width);
+            bitNum -= width;
+        }
+        return;
+    }
+
+    acc |= (uint64_t)(byte & 0x7F) << shift;
+    shift += 7;
+    if((byte & 0x80) != 0){
+        return;
+    }
+
+    uint64_t val = acc;
+    acc = 0;
+    shift = 0;
+    if(stage == Stage::FIRST){
+        prev = (vidx_t)val;
+        out.push_back(prev);
+        stage = (format == CiaoFormat::VARINT) ? Stage::GAPS : Stage::COUNT;
+    }
+    else if(stage == Stage::COUNT){
+        gapNum = (long)val;
+        stage = Stage::WIDTH;
+    }
+    else{
+        prev += (vidx_t)val;
+        out.push_back(prev);
+    }
+}
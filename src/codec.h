@@ -0,0 +1,55 @@
+#ifndef __CODEC_H__
+#define __CODEC_H__
+
+#include <list>
+#include <vector>
+#include <cstdint>
+#include "common.h"
+
+// Compressed outgoing neighbour lists. The neighbours of a vertex are
+// sorted and stored as the first index followed by the gaps between
+// the adjacent neighbours, which are small on most of the graphs.
+//   varint   Each value takes 7 bits per byte from the least significant
+//            bits, and the high bit is set on all the bytes but the last.
+//   bitpack  The first index and the number of gaps are varints. They are
+//            followed by a byte of the bit width of the largest gap and
+//            the gaps packed with the width from the least significant bit.
+// An empty list takes no byte in both formats. The decoder works on one
+// byte at a time, so that the list can be decoded while it is streamed in.
+class CiaoCodec{
+    public:
+        CiaoCodec();
+
+        // Append the encoded ngbs to out. ngbs is sorted in place.
+        static void encode(
+                CiaoFormat format,
+                std::vector<vidx_t> &ngbs,
+                std::vector<char> &out);
+
+        // Start decoding a list of len bytes.
+        void start(CiaoFormat format, long len);
+        void decodeByte(uint8_t byte, std::list<vidx_t> &out);
+        bool isIdle() const { return remainingLen == 0; }
+
+    private:
+        enum class Stage {FIRST, COUNT, WIDTH, GAPS};
+
+        CiaoFormat format;
+        Stage stage;
+        long remainingLen;
+        vidx_t prev;
+
+        // Partial varint
+        uint64_t acc;
+        int shift;
+
+        // Bit-packed gaps
+        long gapNum;
+        int width;
+        uint64_t bitBuf;
+        int bitNum;
+
+        static void putVarint(uint64_t val, std::vector<char> &out);
+};
+
+#endif
@@ -1,9 +1,12 @@
 #include "common.h"
+#include "program.h"
+#include <thread>
+#include <algorithm>
 
 // This will be updated in MemWrapper::loadGraph() 
-int GL::vertexNum = 0;
-int GL::edgeNum = 0;
-std::vector<int> GL::startingVertices;
+long GL::vertexNum = 0;
+long GL::edgeNum = 0;
+std::vector<vidx_t> GL::startingVertices;
 std::vector<BurstOp*> GL::bursts;
 
 // This will be updated in main.
@@ -12,6 +15,7 @@ int GL::beta = 5000;
 int GL::cacheThreshold = 0;
 int GL::hubVertexThreshold = 0;
 int GL::startNum = 10;
+VertexOrder GL::vertexOrder = VertexOrder::ORIGINAL;
 
 // This can be used as default value
 int GL::depthBufferDepth = 4096;
@@ -21,22 +25,55 @@ int GL::rpaiBufferDepth = 4096;
 int GL::ciaiBufferDepth = 4096;
 int GL::frontierBufferDepth = 4096;
 
-// They are updated in MemWrapper::ramInit()
-long GL::depthMemAddr = 0;
-long GL::rpaoMemAddr = 0;
-long GL::ciaoMemAddr = 0;
-long GL::rpaiMemAddr = 0;
-long GL::ciaiMemAddr = 0;
-long GL::frontierMemAddr = 0;
+CiaoFormat GL::ciaoFormat = CiaoFormat::RAW;
+int GL::ciaoDecodeRate = 4;
+
+FrontierMode GL::frontierMode = FrontierMode::DENSE;
+double GL::sparseThreshold = 1.0;
+
+// The partitions are updated in MemWrapper::ramInit()
+int GL::peNum = 1;
+int GL::msgLatency = 4;
+std::vector<Partition> GL::partitions;
 
 long GL::reqIdx = -1;
 long GL::burstIdx = -1;
 int GL::portIdx = -1;
 int GL::burstLen = 64;
 int GL::baseLen = 1024; // 1024 bytes
+std::vector<int> GL::portBaseLen(PNUM, 0);
+int GL::adaptiveBaseLen = 0;
+double GL::memQueueOccupancy = 0;
+
+// The random depth reads and writes of the expansion go first by default.
+ArbiterPolicy GL::arbiterPolicy = ArbiterPolicy::FIFO;
+std::vector<int> GL::portWeight(PNUM, 1);
+std::vector<int> GL::portPriority{0, 0, 0, 0, 1, 1, 2, 2};
+int GL::drrQuantum = 256;
 int GL::burstAddrWidth = GL::getBurstAddrWidth();
 
 int GL::logon = 0;
+int GL::hostThreadNum = 0;
+
+double GL::peClkCycle = 2.5;
+double GL::memClkCycle = 0;
+int GL::memIdleSkip = 1;
+int GL::reqQueueDepth = 0;
+int GL::memIssueWidth = 1;
+int GL::chanQueueDepth = 1;
+int GL::writeComplete = 0;
+int GL::asyncBfs = 0;
+Algorithm GL::algorithm = Algorithm::BFS;
+int GL::pageRankIterNum = 10;
+int GL::maxEdgeWeight = 255;
+int GL::verifyBfs = 0;
+
+long GL::bfsRuntime = 0;
+double GL::memEnergy = 0;
+long GL::ciaoReadBytes = 0;
+long GL::ciaoDecodeCycles = 0;
+std::vector<long> GL::frontierSizes;
+std::string GL::depthDumpFile = "./depth.txt";
 
 void GL::cfgBfsParam(const std::string &cfgFileName){
 
@@ -51,29 +88,279 @@ void GL::cfgBfsParam(const std::string &cfgFileName){
     std::string graphDir;
     while(!fhandle.eof()){
         std::string cfgKey;
-        fhandle >> cfgKey;
-        if(cfgKey == "alpha"){
-            fhandle >> alpha;
+        std::string cfgVal;
+        fhandle >> cfgKey >> cfgVal;
+        setBfsParam(cfgKey, cfgVal);
+    }
+
+    fhandle.close();
+
+}
+
+// The per port parameters are named as the prefix followed by 
+// the pe port index, e.g. baseLen5.
+static bool getPortKeyIdx(const std::string &key, const std::string &prefix, int &portIdx){
+    if(key.size() != prefix.size() + 1 || key.compare(0, prefix.size(), prefix) != 0){
+        return false;
+    }
+    portIdx = key.back() - '0';
+    return portIdx >= 0 && portIdx < PNUM;
+}
+
+// Update a single parameter. It returns false when the key is not a 
+// bfs parameter, e.g. graphName which is parsed by the memory wrapper.
+bool GL::setBfsParam(const std::string &key, const std::string &val){
+
+    std::istringstream iss(val);
+    int portIdx;
+    if(key == "alpha"){
+        iss >> alpha;
+    }
+    else if(key == "beta"){
+        iss >> beta;
+    }
+    else if(key == "cacheThreshold"){
+        iss >> cacheThreshold;
+    }
+    else if(key == "hubVertexThreshold"){
+        iss >> hubVertexThreshold;
+    }
+    else if(key == "startNum"){
+        iss >> startNum;
+    }
+    else if(key == "logon"){
+        iss >> logon;
+    }
+    else if(key == "baseLen"){
+        iss >> baseLen;
+        if(baseLen <= 0 || baseLen % (int)sizeof(vidx_t) != 0){
+            HERE;
+            std::cout << "baseLen must be a positive multiple of " << sizeof(vidx_t) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(getPortKeyIdx(key, "baseLen", portIdx)){
+        // The split must not cut a vertex index, e.g. of the frontier 
+        // queue, across two bursts.
+        iss >> portBaseLen[portIdx];
+        if(portBaseLen[portIdx] % (int)sizeof(vidx_t) != 0){
+            HERE;
+            std::cout << key << " must be a multiple of " << sizeof(vidx_t) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(getPortKeyIdx(key, "portWeight", portIdx)){
+        iss >> portWeight[portIdx];
+        // A port of weight 0 would never earn a turn and starve.
+        if(portWeight[portIdx] <= 0){
+            HERE;
+            std::cout << "Invalid " << key << " " << val << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(getPortKeyIdx(key, "portPriority", portIdx)){
+        iss >> portPriority[portIdx];
+    }
+    else if(key == "drrQuantum"){
+        iss >> drrQuantum;
+        if(drrQuantum <= 0){
+            HERE;
+            std::cout << "Invalid drrQuantum " << val << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(key == "arbiter"){
+        if(val == "fifo"){
+            arbiterPolicy = ArbiterPolicy::FIFO;
+        }
+        else if(val == "rr"){
+            arbiterPolicy = ArbiterPolicy::RR;
+        }
+        else if(val == "weighted"){
+            arbiterPolicy = ArbiterPolicy::WEIGHTED;
+        }
+        else if(val == "priority"){
+            arbiterPolicy = ArbiterPolicy::PRIORITY;
+        }
+        else if(val == "drr"){
+            arbiterPolicy = ArbiterPolicy::DRR;
+        }
+        else{
+            HERE;
+            std::cout << "Unknown arbiter " << val << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(key == "adaptiveBaseLen"){
+        iss >> adaptiveBaseLen;
+    }
+    else if(key == "depthBufferDepth"){
+        iss >> depthBufferDepth;
+    }
+    else if(key == "rpaoBufferDepth"){
+        iss >> rpaoBufferDepth;
+    }
+    else if(key == "ciaoBufferDepth"){
+        iss >> ciaoBufferDepth;
+    }
+    else if(key == "rpaiBufferDepth"){
+        iss >> rpaiBufferDepth;
+    }
+    else if(key == "ciaiBufferDepth"){
+        iss >> ciaiBufferDepth;
+    }
+    else if(key == "frontierBufferDepth"){
+        iss >> frontierBufferDepth;
+    }
+    else if(key == "peClkCycle"){
+        iss >> peClkCycle;
+    }
+    else if(key == "memClkCycle"){
+        iss >> memClkCycle;
+    }
+    else if(key == "memIdleSkip"){
+        iss >> memIdleSkip;
+    }
+    else if(key == "reqQueueDepth"){
+        iss >> reqQueueDepth;
+    }
+    else if(key == "memIssueWidth"){
+        iss >> memIssueWidth;
+    }
+    else if(key == "chanQueueDepth"){
+        iss >> chanQueueDepth;
+    }
+    else if(key == "writeComplete"){
+        iss >> writeComplete;
+    }
+    else if(key == "asyncBfs"){
+        iss >> asyncBfs;
+    }
+    else if(key == "algorithm"){
+        if(val == "bfs"){
+            algorithm = Algorithm::BFS;
+        }
+        else if(val == "sssp"){
+            algorithm = Algorithm::SSSP;
         }
-        else if(cfgKey == "beta"){
-            fhandle >> beta;
+        else if(val == "cc"){
+            algorithm = Algorithm::CC;
         }
-        else if(cfgKey == "cacheThreshold"){
-            fhandle >> cacheThreshold;
+        else if(val == "pagerank"){
+            algorithm = Algorithm::PAGERANK;
         }
-        else if(cfgKey == "hubVertexThreshold"){
-            fhandle >> hubVertexThreshold;
+        else{
+            HERE;
+            std::cout << "Unknown algorithm " << val << std::endl;
+            exit(EXIT_FAILURE);
         }
-        else if(cfgKey == "startNum"){
-            fhandle >> startNum;
+    }
+    else if(key == "pageRankIterNum"){
+        iss >> pageRankIterNum;
+        // The iterations are counted by the char level of the pes.
+        if(pageRankIterNum <= 0 || pageRankIterNum > INT8_MAX){
+            HERE;
+            std::cout << "Invalid pageRankIterNum " << val << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(key == "maxEdgeWeight"){
+        iss >> maxEdgeWeight;
+    }
+    else if(key == "verifyBfs"){
+        iss >> verifyBfs;
+    }
+    else if(key == "hostThreadNum"){
+        iss >> hostThreadNum;
+    }
+    else if(key == "ciaoFormat"){
+        if(val == "raw"){
+            ciaoFormat = CiaoFormat::RAW;
+        }
+        else if(val == "varint"){
+            ciaoFormat = CiaoFormat::VARINT;
+        }
+        else if(val == "bitpack"){
+            ciaoFormat = CiaoFormat::BITPACK;
+        }
+        else{
+            HERE;
+            std::cout << "Unknown ciao format " << val << std::endl;
+            exit(EXIT_FAILURE);
         }
-        else if(cfgKey == "logon"){
-            fhandle >> logon;
+    }
+    else if(key == "vertexOrder"){
+        if(val == "original"){
+            vertexOrder = VertexOrder::ORIGINAL;
+        }
+        else if(val == "degree"){
+            vertexOrder = VertexOrder::DEGREE;
+        }
+        else if(val == "hub"){
+            vertexOrder = VertexOrder::HUB;
+        }
+        else if(val == "rcm"){
+            vertexOrder = VertexOrder::RCM;
+        }
+        else{
+            HERE;
+            std::cout << "Unknown vertex order " << val << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(key == "frontierMode"){
+        if(val == "dense"){
+            frontierMode = FrontierMode::DENSE;
+        }
+        else if(val == "sparse"){
+            frontierMode = FrontierMode::SPARSE;
+        }
+        else if(val == "auto"){
+            frontierMode = FrontierMode::AUTO;
+        }
+        else{
+            HERE;
+            std::cout << "Unknown frontier mode " << val << std::endl;
+            exit(EXIT_FAILURE);
         }
     }
+    else if(key == "sparseThreshold"){
+        iss >> sparseThreshold;
+    }
+    else if(key == "peNum"){
+        iss >> peNum;
+    }
+    else if(key == "msgLatency"){
+        iss >> msgLatency;
+    }
+    else if(key == "ciaoDecodeRate"){
+        iss >> ciaoDecodeRate;
+    }
+    else{
+        return false;
+    }
 
-    fhandle.close();
+    return true;
+}
+
+// The vertices are split evenly and the last partition 
+// takes the remaining vertices.
+int GL::getPartitionIdx(long vidx){
+    long len = vertexNum / peNum;
+    return (int)std::min((long)peNum - 1, vidx / len);
+}
+
+int GL::getBaseLen(int portIdx){
+    int len = portBaseLen[portIdx];
+    return (len > 0) ? len : baseLen;
+}
 
+// The depth array of a partition holds the property arrays of its 
+// vertices back to back, and slot selects the array.
+long GL::getDepthMemAddr(long vidx, int slot){
+    const Partition &part = partitions[getPartitionIdx(vidx)];
+    long vNum = part.vertexEnd - part.vertexBegin;
+    return part.depthMemAddr + (slot * vNum + vidx - part.vertexBegin) * (long)VertexProgram::getPropSize();
 }
 
 int GL::getPortIdx(){
@@ -91,10 +378,49 @@ long GL::getReqIdx(){
     return reqIdx;
 }
 
+int GL::getHostThreadNum(){
+    if(hostThreadNum > 0){
+        return hostThreadNum;
+    }
+    int num = (int)std::thread::hardware_concurrency();
+    return num > 0 ? num : 1;
+}
+
+void GL::parallelFor(
+        long begin, 
+        long end, 
+        const std::function<void(int, long, long)> &func)
+{
+    int threadNum = getHostThreadNum();
+    long len = (end - begin + threadNum - 1) / threadNum;
+    std::vector<std::thread> threads;
+    for(int tid = 1; tid < threadNum; tid++){
+        long rangeBegin = std::min(end, begin + tid * len);
+        long rangeEnd = std::min(end, rangeBegin + len);
+        threads.push_back(std::thread(func, tid, rangeBegin, rangeEnd));
+    }
+    func(0, begin, std::min(end, begin + len));
+    for(auto &t : threads){
+        t.join();
+    }
+}
+
+// The time resolution is ps, as the memory clock period 
+// derived from tCK is usually not an integer in ns.
+long GL::getTimeStamp(){
+    return (long)(sc_time_stamp()/sc_time(1, SC_PS));
+}
+
+// The basic burst length depends on the memory standard. 
+void GL::setBurstLen(int len){
+    burstLen = len;
+    burstAddrWidth = getBurstAddrWidth();
+}
+
 // Calculate the # of bits when mapping a basic memory burst to the address.
 int GL::getBurstAddrWidth(){
 
-    int width = 1;
+    int width = 0;
     int val = 1;
     for(int i = 0; i <= 10; i++){
         if(val == burstLen){
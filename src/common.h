@@ -3,6 +3,8 @@
 
 #include <list>
 #include <sstream>
+#include <functional>
+#include <cstdint>
 #include "Request.h"
 #include "systemc.h"
 
@@ -14,6 +16,42 @@ std::ostream& operator<<(std::ostream &os, const ramulator::Request::Type &type)
 // This macro is used to locate the code position.
 #define HERE do {std::cout <<"File: " << __FILE__ << " Line: " << __LINE__ << std::endl;} while(0)
 
+// Width in bytes of the vertex indices (ciao, ciai and frontier) and the 
+// edge indices (rpao and rpai) stored in the memory. 32-bit indices are 
+// used by default, and graphs with more than 2^31 edges such as twitter 
+// and friendster need EIDX_BYTES=8, which is set in the Makefile.
+#ifndef VIDX_BYTES
+#define VIDX_BYTES 4
+#endif
+
+#ifndef EIDX_BYTES
+#define EIDX_BYTES 4
+#endif
+
+template<int bytes> struct IndexType;
+template<> struct IndexType<4> { typedef int32_t type; };
+template<> struct IndexType<8> { typedef int64_t type; };
+
+typedef IndexType<VIDX_BYTES>::type vidx_t;
+typedef IndexType<EIDX_BYTES>::type eidx_t;
+
+// Format of the outgoing neighbour lists (ciao) in the memory. See 
+// CiaoCodec in codec.h for the compressed formats.
+enum class CiaoFormat {RAW, VARINT, BITPACK};
+
+// Numbering of the vertices in the memory. See Graph::reorder().
+enum class VertexOrder {ORIGINAL, DEGREE, HUB, RCM};
+
+// How the pe finds the frontier of a level. See pe::startLevel().
+enum class FrontierMode {DENSE, SPARSE, AUTO};
+
+// Arbitration between the pe ports in the memory wrapper. See PortArbiter 
+// in arbiter.h.
+enum class ArbiterPolicy {FIFO, RR, WEIGHTED, PRIORITY, DRR};
+
+// The graph algorithm run by the pes. See VertexProgram in program.h.
+enum class Algorithm {BFS, SSSP, CC, PAGERANK};
+
 // ----------------------------------------------------------------------------
 // The burst operation is decoded in the memory wrapper and 
 // it provides a simple and easy-to-use interface to the processing elements.
@@ -114,12 +152,34 @@ struct BurstOp{
         int getOffset() const;
 };
 
+// A partition owns the vertices [vertexBegin, vertexEnd) and the slices 
+// of all the graph arrays of these vertices. The slices are placed in 
+// the continuous address range [baseAddr, endAddr), and the row pointers 
+// in the rpao/rpai slices are relative to the start of the ciao/ciai 
+// slices. The range is pinned to a single memory channel at channelBase 
+// of the channel, see MemWrapper::getChannelAddr().
+struct Partition{
+    long vertexBegin;
+    long vertexEnd;
+    long baseAddr;
+    long depthMemAddr;
+    long rpaoMemAddr;
+    long ciaoMemAddr;
+    long rpaiMemAddr;
+    long ciaiMemAddr;
+    long frontierMemAddr;
+    long frontierSize;    // # of vertices in the initial frontier queue
+    long endAddr;
+    int channel;
+    long channelBase;
+};
+
 class GL{
     public:
         // Application parameters
-        static int vertexNum;
-        static int edgeNum;
-        static std::vector<int> startingVertices;
+        static long vertexNum;
+        static long edgeNum;
+        static std::vector<vidx_t> startingVertices;
 
         // cache based bfs parameter
         static float alpha;
@@ -127,15 +187,16 @@ class GL{
         static int cacheThreshold;
         static int hubVertexThreshold;
         static int startNum;
+        static VertexOrder vertexOrder;
 
-        // Initial va, vb, and vp address. 
-        // Suppose they stay in a continuous address space.
-        static long depthMemAddr;
-        static long rpaoMemAddr;
-        static long ciaoMemAddr;
-        static long rpaiMemAddr;
-        static long ciaiMemAddr;
-        static long frontierMemAddr;
+        // The vertices are split into peNum partitions, one per pe. The 
+        // depth updates of the vertices in other partitions are sent to 
+        // the owner pe as messages that arrive after msgLatency pe cycles.
+        static int peNum;
+        static int msgLatency;
+        static std::vector<Partition> partitions;
+        static int getPartitionIdx(long vidx);
+        static long getDepthMemAddr(long vidx, int slot = 0);
 
         // Processing element setup
         static int depthBufferDepth;
@@ -145,11 +206,82 @@ class GL{
         static int ciaiBufferDepth;
         static int frontierBufferDepth;
 
+        // ciao is stored in ciaoFormat, and the compressed neighbour lists 
+        // are decoded at ciaoDecodeRate bytes per pe cycle.
+        static CiaoFormat ciaoFormat;
+        static int ciaoDecodeRate;
+
+        // The frontier is found by scanning the depth (dense) or by reading 
+        // the queue of the vertices visited in the previous level (sparse). 
+        // In auto mode a level is sparse when the queue is smaller than 
+        // sparseThreshold times the depth array in bytes.
+        static FrontierMode frontierMode;
+        static double sparseThreshold;
+
         // It will be reset based on memory configuration
         static int burstLen; 
         static int burstAddrWidth;
         static int logon;
 
+        // # of host threads used to prepare the graph and the memory 
+        // image. All the cores are used when it is not positive.
+        static int hostThreadNum;
+
+        // Clock periods in ns. They are part of the configuration so that 
+        // they can be swept. When memClkCycle is not positive, the memory 
+        // clock is derived from tCK of the selected memory standard.
+        static double peClkCycle;
+        static double memClkCycle;
+
+        // The memory simulation skips the cycles in which the memory is idle.
+        static int memIdleSkip;
+
+        // Depth of the request queue of each pe port in the memory wrapper, 
+        // in memory requests. A pe port sends a burst only when it holds 
+        // the credits of all its requests, and the credits are returned 
+        // as the requests leave the queue. The queue is infinite when it 
+        // is not positive.
+        static int reqQueueDepth;
+
+        // # of requests sent to the memory controllers per memory cycle, 
+        // and the depth of the queue of each channel in front of them.
+        static int memIssueWidth;
+        static int chanQueueDepth;
+
+        // The write bursts are complete when their data is written to the 
+        // DRAM instead of when the memory controllers accept them.
+        static int writeComplete;
+
+        // Asynchronous bfs without the level barrier. A vertex is expanded 
+        // as soon as its depth is lowered, and its neighbours are lowered 
+        // to its depth + 1. It works with the dense frontierMode only.
+        static int asyncBfs;
+
+        // The graph algorithm, the # of pagerank iterations and the 
+        // largest edge weight of sssp.
+        static Algorithm algorithm;
+        static int pageRankIterNum;
+        static int maxEdgeWeight;
+
+        // The result of bfs or sssp is checked against a software bfs or 
+        // Dijkstra on the graph in the host memory from the same starting 
+        // vertex, and the simulation fails when they do not agree.
+        static int verifyBfs;
+
+        // Simulation results. bfsRuntime is the time stamp in ps when the 
+        // empty frontier is detected. The depth is dumped to depthDumpFile 
+        // at the end of the simulation unless the file name is empty.
+        // memEnergy is the DRAM energy in J consumed till the end of bfs.
+        // ciaoReadBytes and ciaoDecodeCycles are the ciao traffic and the 
+        // busy cycles of the ciao decoder in the pe. frontierSizes is the 
+        // # of frontier vertices found by all the pes in each level.
+        static long bfsRuntime;
+        static double memEnergy;
+        static long ciaoReadBytes;
+        static long ciaoDecodeCycles;
+        static std::vector<long> frontierSizes;
+        static std::string depthDumpFile;
+
         // Gloabl container that stores all the bursts created in the bfs.
         // When the a burst is no longer used, the allocated memory will be 
         // released and the corresponding element in the vector will be set 
@@ -160,10 +292,38 @@ class GL{
         // bursts such that the burst will not be overflow 
         // the buffer and block shorter bursts coming afterwards.
         static int baseLen;
+
+        // The base length can be set per pe port, and it follows baseLen 
+        // when it is not positive. With adaptiveBaseLen, the pe shortens 
+        // the bursts further as memQueueOccupancy, the pending read 
+        // requests over the read queue capacity of all the controllers, 
+        // goes up.
+        static std::vector<int> portBaseLen;
+        static int adaptiveBaseLen;
+        static double memQueueOccupancy;
+        static int getBaseLen(int portIdx);
+
+        // Port arbitration in the memory wrapper. The weight and the 
+        // priority are set per pe port, and drrQuantum is in bytes.
+        static ArbiterPolicy arbiterPolicy;
+        static std::vector<int> portWeight;
+        static std::vector<int> portPriority;
+        static int drrQuantum;
         static long getReqIdx();
+        static long getTimeStamp(); // current simulation time in ps
+        static void setBurstLen(int len);
         static long getBurstIdx();
         static int getPortIdx();
         static void cfgBfsParam(const std::string &cfgFileName);
+        static bool setBfsParam(const std::string &key, const std::string &val);
+        static int getHostThreadNum();
+
+        // Split [begin, end) into a continuous range per host thread, 
+        // and func(tid, rangeBegin, rangeEnd) is invoked in each thread.
+        static void parallelFor(
+                long begin, 
+                long end, 
+                const std::function<void(int, long, long)> &func);
 
     private:
         static int portIdx;
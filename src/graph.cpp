@@ -1,71 +1,263 @@
 #include "graph.h"
+#include <cctype>
+#include <cstring>
+#include <limits>
 
-void Graph::loadFile(
-        const std::string& fname, 
-        std::vector<std::vector<int>> &data
-        ){
-
-    std::ifstream fhandle(fname.c_str());
-    if(!fhandle.is_open()){
+// The edge list is read through a fixed size buffer and only the complete
+// lines in the buffer are parsed. Each line is expected to start with the
+// source and destination vertex indices, and comment lines starting with
+// '#' or '%' are skipped. The parsed edges are handed to visitBlock(block)
+// in blocks of edgeBlockSize edges following the order of the file.
+template<typename Visitor>
+void Graph::scanFile(const std::string& fname, Visitor visitBlock){
+    FILE* fhandle = fopen(fname.c_str(), "r");
+    if(fhandle == NULL){
         HERE;
         std::cout << "Failed to open " << fname << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    std::string line;
-    while(std::getline(fhandle, line)){
-        std::istringstream iss(line);
-        data.push_back(
-                std::vector<int>(std::istream_iterator<int>(iss),
-                    std::istream_iterator<int>())
-                );
+    std::vector<char> buffer(readBufferSize);
+    EdgeBlock block;
+    block.reserve(edgeBlockSize);
+    size_t len = 0;
+    bool eof = false;
+    while(!eof || len > 0){
+        if(!eof){
+            len += fread(&buffer[len], 1, buffer.size() - len, fhandle);
+            eof = len < buffer.size();
+        }
+
+        // The partial line at the end of the buffer is left to the next read.
+        size_t end = len;
+        if(!eof){
+            while(end > 0 && buffer[end - 1] != '\n') end--;
+            if(end == 0){
+                HERE;
+                std::cout << "Too long line is found in " << fname << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        const char* p = buffer.data();
+        const char* bufferEnd = p + end;
+        while(p < bufferEnd){
+            const char* eol = (const char*)memchr(p, '\n', bufferEnd - p);
+            if(eol == NULL) eol = bufferEnd;
+
+            long vids[2];
+            int n = 0;
+            while(n < 2 && p < eol){
+                while(p < eol && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) p++;
+                if(p == eol || !isdigit(*p)) break;
+                long vid = 0;
+                while(p < eol && isdigit(*p)){
+                    vid = vid * 10 + (*p - '0');
+                    p++;
+                }
+                vids[n++] = vid;
+            }
+            if(n == 2 && std::max(vids[0], vids[1]) >= (long)std::numeric_limits<vidx_t>::max()){
+                HERE;
+                std::cout << "Vertex index " << std::max(vids[0], vids[1]);
+                std::cout << " exceeds the index width. Rebuild with VIDX_BYTES=8." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            if(n == 2){
+                block.push_back(std::make_pair((vidx_t)vids[0], (vidx_t)vids[1]));
+                if((int)block.size() == edgeBlockSize){
+                    visitBlock(block);
+                    block.clear();
+                }
+            }
+            p = eol + 1;
+        }
+
+        memmove(buffer.data(), buffer.data() + end, len - end);
+        len -= end;
+    }
+    fclose(fhandle);
+
+    if(!block.empty()){
+        visitBlock(block);
     }
-    fhandle.close();
 }
 
-// Check the number of vertices without out going neighbors,
-// as it affects the BFS results.
-void Graph::getStat(){
-    int zero_outgoing_vertex_num = 0;
-    for(auto it = vertices.begin(); it != vertices.end(); it++){
-        if((*it)->out_vids.empty()){
-            zero_outgoing_vertex_num++;
+// Prefix sum of vec[1..n] in place with vec[0] left at 0, which turns
+// the degrees in vec[1..n] into the row pointers. Each thread sums up a
+// continuous range first and then adds the sum of all the ranges before it.
+template<typename T>
+static void prefixSum(std::vector<T> &vec){
+    int threadNum = GL::getHostThreadNum();
+    std::vector<T> rangeSum(threadNum, 0);
+    long n = (long)vec.size() - 1;
+    GL::parallelFor(1, n + 1, [&vec, &rangeSum](int tid, long begin, long end){
+        for(long i = begin + 1; i < end; i++){
+            vec[i] += vec[i - 1];
         }
+        rangeSum[tid] = (begin < end) ? vec[end - 1] : 0;
+    });
+
+    for(int i = 1; i < threadNum; i++){
+        rangeSum[i] += rangeSum[i - 1];
     }
-    std::cout << "Zero outgoing vertex percentage is " << zero_outgoing_vertex_num * 1.0 / vertex_num << std::endl;
+
+    GL::parallelFor(1, n + 1, [&vec, &rangeSum](int tid, long begin, long end){
+        if(tid == 0) return;
+        for(long i = begin; i < end; i++){
+            vec[i] += rangeSum[tid - 1];
+        }
+    });
 }
 
-int Graph::getMaxIdx(const std::vector<std::vector<int>> &data){
-    int max_idx = data[0][0]; 
-    for(auto it1 = data.begin(); it1 != data.end(); it1++){
-        for(auto it2 = it1->begin(); it2 != it1->end(); it2++){            
-            if(max_idx <= (*it2)){
-                max_idx = *it2;
+// The block is split into a continuous range of edges per thread, and 
+// each thread sorts its edges into buckets[tid][owner] by the owner 
+// threads of the two end vertices. Each owner then visits the buckets of 
+// all the ranges in order, so the edges of a vertex keep the order of the 
+// edge list and each edge is read by at most two owners rather than by 
+// all the threads. visit(tid, e) must only update the vertices of tid.
+template<typename Visitor>
+void Graph::visitOwnedEdges(
+        const EdgeBlock &block, 
+        std::vector<std::vector<EdgeBlock>> &buckets, 
+        Visitor visit)
+{
+    int threadNum = GL::getHostThreadNum();
+    if(threadNum == 1){
+        for(const auto &e : block){
+            visit(0, e);
+        }
+        return;
+    }
+
+    buckets.resize(threadNum);
+    GL::parallelFor(0, (long)block.size(), [threadNum, &block, &buckets](int tid, long begin, long end){
+        std::vector<EdgeBlock> &local = buckets[tid];
+        local.resize(threadNum);
+        for(auto &bucket : local){
+            bucket.clear();
+        }
+        for(long i = begin; i < end; i++){
+            int srcOwner = block[i].first % threadNum;
+            int dstOwner = block[i].second % threadNum;
+            local[srcOwner].push_back(block[i]);
+            if(dstOwner != srcOwner){
+                local[dstOwner].push_back(block[i]);
+            }
+        }
+    });
+
+    GL::parallelFor(0, threadNum, [threadNum, &buckets, &visit](int tid, long, long){
+        for(int range = 0; range < threadNum; range++){
+            for(const auto &e : buckets[range][tid]){
+                visit(tid, e);
             }
         }
+    });
+}
+
+// The degrees are accumulated in rpao/rpai with an offset of one vertex,
+// so that they turn into the row pointers after the prefix sum.
+void Graph::countDegree(const std::string& fname){
+    int threadNum = GL::getHostThreadNum();
+    long lineNum = 0;
+    long maxIdx = -1;
+    std::vector<std::vector<EdgeBlock>> buckets;
+    rpao.clear();
+    rpai.clear();
+    scanFile(fname, [this, threadNum, &lineNum, &maxIdx, &buckets](const EdgeBlock &block){
+        for(const auto &e : block){
+            maxIdx = std::max(maxIdx, (long)std::max(e.first, e.second));
+        }
+        if(maxIdx + 2 > (long)rpao.size()){
+            size_t size = std::max((size_t)maxIdx + 2, rpao.size() * 2);
+            rpao.resize(size, 0);
+            rpai.resize(size, 0);
+        }
+        lineNum += (long)block.size();
+
+        visitOwnedEdges(block, buckets, [this, threadNum](int tid, const std::pair<vidx_t, vidx_t> &e){
+            vidx_t src = e.first;
+            vidx_t dst = e.second;
+            if(src % threadNum == tid){
+                rpao[src + 1]++;
+                if(isUgraph && src != dst) rpai[src + 1]++;
+            }
+            if(dst % threadNum == tid){
+                rpai[dst + 1]++;
+                if(isUgraph && src != dst) rpao[dst + 1]++;
+            }
+        });
+    });
+
+    if(lineNum == 0){
+        HERE;
+        std::cout << "No edge is found in " << fname << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    vertex_num = maxIdx + 1;
+    edge_num = lineNum;
+    if(isUgraph) edge_num *= 2;
+
+    if(edge_num > (long)std::numeric_limits<eidx_t>::max()){
+        HERE;
+        std::cout << "Edge num " << edge_num << " exceeds the index width. ";
+        std::cout << "Rebuild with EIDX_BYTES=8." << std::endl;
+        exit(EXIT_FAILURE);
     }
-    return max_idx;
+
+    rpao.resize(vertex_num + 1);
+    rpai.resize(vertex_num + 1);
+    rpao.shrink_to_fit();
+    rpai.shrink_to_fit();
+    prefixSum(rpao);
+    prefixSum(rpai);
 }
 
-int Graph::getMinIdx(const std::vector<std::vector<int>> &data){
-    int min_idx = data[0][0]; 
-    for(auto it1 = data.begin(); it1 != data.end(); it1++){
-        for(auto it2 = it1->begin(); it2 != it1->end(); it2++){            
-            if(min_idx >= (*it2)){
-                min_idx = *it2;
+// The neighbours of each vertex keep the order of the edge list.
+void Graph::scatterEdges(const std::string& fname){
+    int threadNum = GL::getHostThreadNum();
+    ciao.resize(rpao[vertex_num]);
+    ciai.resize(rpai[vertex_num]);
+    std::vector<eidx_t> outPos(rpao.begin(), rpao.end() - 1);
+    std::vector<eidx_t> inPos(rpai.begin(), rpai.end() - 1);
+    std::vector<std::vector<EdgeBlock>> buckets;
+    scanFile(fname, [this, threadNum, &outPos, &inPos, &buckets](const EdgeBlock &block){
+        visitOwnedEdges(block, buckets, [this, threadNum, &outPos, &inPos](int tid, const std::pair<vidx_t, vidx_t> &e){
+            vidx_t src = e.first;
+            vidx_t dst = e.second;
+            if(src % threadNum == tid){
+                ciao[outPos[src]++] = dst;
+                if(isUgraph && src != dst) ciai[inPos[src]++] = dst;
             }
+            if(dst % threadNum == tid){
+                ciai[inPos[dst]++] = src;
+                if(isUgraph && src != dst) ciao[outPos[dst]++] = src;
+            }
+        });
+    });
+}
+
+// Check the number of vertices without out going neighbors,
+// as it affects the BFS results.
+void Graph::getStat(){
+    long zero_outgoing_vertex_num = 0;
+    for(long i = 0; i < vertex_num; i++){
+        if(getOutDeg(i) == 0){
+            zero_outgoing_vertex_num++;
         }
     }
-    return min_idx;
+    std::cout << "Zero outgoing vertex percentage is " << zero_outgoing_vertex_num * 1.0 / vertex_num << std::endl;
 }
 
-void Graph::getRandomStartIndices(std::vector<int> &start_indices){
+void Graph::getRandomStartIndices(std::vector<vidx_t> &start_indices){
     start_indices.clear();
     int n = 0;
     while(n < GL::startNum){
-        int max_idx = vertex_num - 1;
-        int idx = rand()%max_idx;
-        if(vertices[idx]->out_vids.empty() || std::find(start_indices.begin(), start_indices.end(), idx) != start_indices.end()){
+        long max_idx = vertex_num - 1;
+        vidx_t idx = (vidx_t)(rand()%max_idx);
+        if(getOutDeg(idx) == 0 || std::find(start_indices.begin(), start_indices.end(), idx) != start_indices.end()){
             continue;
         }
         start_indices.push_back(idx);
@@ -73,14 +265,146 @@ void Graph::getRandomStartIndices(std::vector<int> &start_indices){
     }
 }
 
-void Graph::printOngb(int vidx){
+void Graph::printOngb(vidx_t vidx){
     std::cout << vidx << " outgoing neighbors: ";
-    for(auto x : vertices[vidx]->out_vids){
-        std::cout << x << " ";
+    for(eidx_t i = rpao[vidx]; i < rpao[vidx + 1]; i++){
+        std::cout << ciao[i] << " ";
     }
     std::cout << std::endl;
 }
 
+// The vertices are listed in descending order of in-degree, as the 
+// in-degree is the number of depth accesses in the top-down expansion. 
+// The ties keep the original order.
+void Graph::getDegreeOrder(bool hubOnly, std::vector<vidx_t> &order){
+    order.resize(vertex_num);
+    for(long i = 0; i < vertex_num; i++){
+        order[i] = (vidx_t)i;
+    }
+
+    auto byDegree = [this](vidx_t a, vidx_t b){ return getInDeg(a) > getInDeg(b); };
+    if(hubOnly == false){
+        std::stable_sort(order.begin(), order.end(), byDegree);
+        return;
+    }
+
+    double avgDeg = (double)edge_num / vertex_num;
+    auto isHub = [this, avgDeg](vidx_t vidx){ return getInDeg(vidx) > avgDeg; };
+    auto hubEnd = std::stable_partition(order.begin(), order.end(), isHub);
+    std::stable_sort(order.begin(), hubEnd, byDegree);
+}
+
+// Each connected component starts from its vertex with the smallest 
+// degree, and the order is reversed at the end.
+void Graph::getRcmOrder(std::vector<vidx_t> &order){
+    auto getDeg = [this](vidx_t vidx){ return getOutDeg(vidx) + getInDeg(vidx); };
+    auto byDegree = [&getDeg](vidx_t a, vidx_t b){ return getDeg(a) < getDeg(b); };
+
+    std::vector<vidx_t> candidates(vertex_num);
+    for(long i = 0; i < vertex_num; i++){
+        candidates[i] = (vidx_t)i;
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), byDegree);
+
+    std::vector<bool> visited(vertex_num, false);
+    order.clear();
+    order.reserve(vertex_num);
+    std::vector<vidx_t> ngbs;
+    for(vidx_t root : candidates){
+        if(visited[root]) continue;
+        visited[root] = true;
+        order.push_back(root);
+
+        // order itself is used as the bfs queue.
+        for(size_t head = order.size() - 1; head < order.size(); head++){
+            vidx_t vidx = order[head];
+            ngbs.clear();
+            for(eidx_t i = rpao[vidx]; i < rpao[vidx + 1]; i++){
+                if(!visited[ciao[i]]){
+                    visited[ciao[i]] = true;
+                    ngbs.push_back(ciao[i]);
+                }
+            }
+            for(eidx_t i = rpai[vidx]; i < rpai[vidx + 1]; i++){
+                if(!visited[ciai[i]]){
+                    visited[ciai[i]] = true;
+                    ngbs.push_back(ciai[i]);
+                }
+            }
+            std::stable_sort(ngbs.begin(), ngbs.end(), byDegree);
+            order.insert(order.end(), ngbs.begin(), ngbs.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+}
+
+// Rebuild a CSR with the vertex order[i] renumbered to i. The neighbours 
+// of each vertex keep their order.
+static void permuteCsr(
+        std::vector<eidx_t> &rp, 
+        std::vector<vidx_t> &ci, 
+        const std::vector<vidx_t> &order,
+        const std::vector<vidx_t> &perm)
+{
+    long n = (long)order.size();
+    std::vector<eidx_t> newRp(n + 1, 0);
+    GL::parallelFor(0, n, [&](int tid, long begin, long end){
+        for(long i = begin; i < end; i++){
+            newRp[i + 1] = rp[order[i] + 1] - rp[order[i]];
+        }
+    });
+    prefixSum(newRp);
+
+    std::vector<vidx_t> newCi(ci.size());
+    GL::parallelFor(0, n, [&](int tid, long begin, long end){
+        for(long i = begin; i < end; i++){
+            eidx_t pos = newRp[i];
+            for(eidx_t j = rp[order[i]]; j < rp[order[i] + 1]; j++){
+                newCi[pos++] = perm[ci[j]];
+            }
+        }
+    });
+    rp.swap(newRp);
+    ci.swap(newCi);
+}
+
+void Graph::reorder(VertexOrder vertexOrder){
+    std::vector<vidx_t> order;
+    if(vertexOrder == VertexOrder::DEGREE){
+        getDegreeOrder(false, order);
+    }
+    else if(vertexOrder == VertexOrder::HUB){
+        getDegreeOrder(true, order);
+    }
+    else if(vertexOrder == VertexOrder::RCM){
+        getRcmOrder(order);
+    }
+    else{
+        return;
+    }
+
+    std::vector<vidx_t> perm(vertex_num);
+    for(long i = 0; i < vertex_num; i++){
+        perm[order[i]] = (vidx_t)i;
+    }
+    permuteCsr(rpao, ciao, order, perm);
+    permuteCsr(rpai, ciai, order, perm);
+
+    // The graph may be reordered again, so the permutations are composed.
+    if(newId.empty()){
+        newId.swap(perm);
+    }
+    else{
+        for(auto &vidx : newId){
+            vidx = perm[vidx];
+        }
+    }
+    oldId.resize(vertex_num);
+    for(long i = 0; i < vertex_num; i++){
+        oldId[newId[i]] = (vidx_t)i;
+    }
+}
+
 Graph::Graph(const std::string& fname){
 
     // Check if it is undirectional graph
@@ -90,35 +414,14 @@ Graph::Graph(const std::string& fname){
     else
         isUgraph = false;
 
-    std::vector<std::vector<int>> data;
-    loadFile(fname, data);
-    vertex_num = getMaxIdx(data) + 1;
-    edge_num = (int)data.size();
-    if(isUgraph) edge_num *= 2;
+    countDegree(fname);
     if(GL::logon != 0){
         std::cout << "vertex num: " << vertex_num << std::endl;
         std::cout << "edge num: " << edge_num << std::endl;
     }
-    for(int i = 0; i < vertex_num; i++){
-        Vertex* v = new Vertex(i);
-        vertices.push_back(v);
-    }
-
-    for(auto it = data.begin(); it != data.end(); it++){
-        int src_idx = (*it)[0];
-        int dst_idx = (*it)[1];
-        vertices[src_idx]->out_vids.push_back(dst_idx);
-        vertices[dst_idx]->in_vids.push_back(src_idx);
-        if(isUgraph && src_idx != dst_idx){
-            vertices[dst_idx]->out_vids.push_back(src_idx);
-            vertices[src_idx]->in_vids.push_back(dst_idx);
-        }
-    }
-
-    for(auto it = vertices.begin(); it != vertices.end(); it++){
-        (*it)->in_deg = (int)(*it)->in_vids.size();
-        (*it)->out_deg = (int)(*it)->out_vids.size();
-    }
+    scatterEdges(fname);
 }
 
-
+Graph::~Graph(){
+    // Nothing is done here.
+}
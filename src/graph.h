@@ -6,51 +6,76 @@
 #include <iostream>
 #include <iterator>
 #include <cstdlib>
+#include <cstdio>
 #include <sstream>
 #include <cmath>
 #include <map>
 #include <algorithm>
 #include "common.h"
 
-class Vertex {
-    public:
-        int idx;
-        int in_deg;
-        int out_deg;
-
-        std::vector<int> in_vids;
-        std::vector<int> out_vids;
-
-        explicit Vertex(int _idx) {
-            idx = _idx;
-        }
-
-        ~Vertex(){
-            // Nothing is done here.
-        }
-
-};
-
+// The graph is stored as compressed sparse row of the outgoing edges
+// (rpao/ciao) and the incoming edges (rpai/ciai). It is built directly
+// from the edge list file in two passes. The first pass counts the
+// degrees and the second pass scatters the edges to the final arrays,
+// so the edge list is never loaded into memory as a whole. The edges are
+// parsed in blocks, and each block is counted and scattered by the host
+// threads in parallel. Each thread owns the vertices with idx % threadNum
+// equal to its thread id, and it gets the edges of its vertices through
+// per-thread buckets, so the neighbours are kept in the order of the edge
+// list without any synchronization. The indices are stored with
+// the widths selected by VIDX_BYTES and EIDX_BYTES in common.h.
 class Graph{
     public:
-        int vertex_num;
-        int edge_num;
-        std::vector<Vertex*> vertices; 
+        long vertex_num;
+        long edge_num;
+        std::vector<eidx_t> rpao;
+        std::vector<vidx_t> ciao;
+        std::vector<eidx_t> rpai;
+        std::vector<vidx_t> ciai;
 
         Graph(const std::string &fname);
         ~Graph();
-        void getRandomStartIndices(std::vector<int> &start_indices);
+        long getOutDeg(vidx_t vidx) const { return rpao[vidx + 1] - rpao[vidx]; }
+        long getInDeg(vidx_t vidx) const { return rpai[vidx + 1] - rpai[vidx]; }
+        void getRandomStartIndices(std::vector<vidx_t> &start_indices);
         void getStat();
-        void printOngb(int vidx);
+        void printOngb(vidx_t vidx);
+
+        // Renumber the vertices and rebuild the CSR arrays accordingly, 
+        // so that the frequently accessed depths are close to each other.
+        //   degree  all the vertices in descending order of in-degree
+        //   hub     the vertices with in-degree above the average are moved 
+        //           to the front in descending order of in-degree, and the 
+        //           rest of the vertices keep the original order
+        //   rcm     reverse Cuthill-McKee, i.e. the reversed bfs order on 
+        //           the undirected graph with the neighbours visited in 
+        //           ascending order of degree
+        // getNewId() maps the original index to the current index, and 
+        // getOldId() maps it back.
+        void reorder(VertexOrder order);
+        vidx_t getNewId(vidx_t vidx) const { return newId.empty() ? vidx : newId[vidx]; }
+        vidx_t getOldId(vidx_t vidx) const { return oldId.empty() ? vidx : oldId[vidx]; }
 
     private:
         bool isUgraph;
-        int getMaxIdx(const std::vector<std::vector<int>> &data);
-        int getMinIdx(const std::vector<std::vector<int>> &data);
-        void loadFile(
-                const std::string& fname,
-                std::vector<std::vector<int>> &data
-                );
+        std::vector<vidx_t> newId; // original index -> current index
+        std::vector<vidx_t> oldId; // current index -> original index
+        static const int readBufferSize = 1 << 20;
+        static const int edgeBlockSize = 1 << 20;
+
+        typedef std::vector<std::pair<vidx_t, vidx_t>> EdgeBlock;
+
+        template<typename Visitor>
+        void scanFile(const std::string& fname, Visitor visitBlock);
+        template<typename Visitor>
+        void visitOwnedEdges(
+                const EdgeBlock &block, 
+                std::vector<std::vector<EdgeBlock>> &buckets, 
+                Visitor visit);
+        void countDegree(const std::string& fname);
+        void scatterEdges(const std::string& fname);
+        void getDegreeOrder(bool hubOnly, std::vector<vidx_t> &order);
+        void getRcmOrder(std::vector<vidx_t> &order);
 
 };
 
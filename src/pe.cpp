@@ -1,10 +1,16 @@
 #include "pe.h"
 
+std::vector<pe*> pe::peGroup;
+bool pe::bfsComplete = false;
+long pe::queueTotal[2] = {0, 0};
+bool pe::queueOverflow[2] = {false, false};
+int pe::sparseLevelNum = 0;
+
 // Constructor
 pe::pe(
         sc_module_name _name, 
         int _peIdx, 
-        int _peClkCycle
+        double _peClkCycle
         ) :sc_module(_name) 
 {
     peIdx = _peIdx;
@@ -12,6 +18,10 @@ pe::pe(
     localCounter = 0;
 
     init();
+    if((int)peGroup.size() <= peIdx){
+        peGroup.resize(peIdx + 1, NULL);
+    }
+    peGroup[peIdx] = this;
 
     // Memory request/response process
     SC_THREAD(sendMemReq);
@@ -54,10 +64,13 @@ pe::pe(
     SC_THREAD(processExpandRpaoReadResp);
     SC_THREAD(issueExpandCiaoReadReq);
     SC_THREAD(processExpandCiaoReadResp);
+    SC_THREAD(decodeExpandCiao);
+    SC_THREAD(processRemoteUpdate);
     SC_THREAD(issueExpandDepthReadReq);
     SC_THREAD(processExpandDepthReadResp);
     SC_THREAD(expandDepthAnalysis);
     SC_THREAD(processExpandDepthWriteResp);
+    SC_THREAD(issueFrontierWriteReq);
 
     // bfs controller
     SC_METHOD(bfsController);
@@ -77,30 +90,65 @@ void pe::init(){
     burstReqQueue.resize(PNUM);
     burstRespQueue.resize(PNUM);
     depthBuffer0.resize(PRNUM);
+    ciaoReadBytes = 0;
+    ciaoDecodedNum = 0;
+    ciaoDecodeCycles = 0;
+    remoteUpdateNum = 0;
+    decodeDepth = 0;
+    expandedNum = 0;
+    correctedNum = 0;
+    splitBurstNum = 0;
+    splitBurstBytes = 0;
+    reqCredits.assign(PNUM, GL::reqQueueDepth);
+    stallCycles.assign(PNUM, 0);
+    inspectDone = false;
+
+    const Partition &part = GL::partitions[peIdx];
+    vertexBegin = part.vertexBegin;
+    vertexNum = part.vertexEnd - part.vertexBegin;
+
+    // The initial queue becomes the current one when level 0 starts.
+    sparse = false;
+    queueIdx = 1;
+    curQueueSize = 0;
+    nextQueueSize = part.frontierSize;
+    nextQueueWritten = part.frontierSize;
+    queueReadLen = 0;
+    queueTotal[0] += part.frontierSize;
+    nextQueued.assign(vertexNum, false);
 }
 
 void pe::inspectDepthReqThread(
         long baseDepthMemAddr,
         int prIdx,
         int portIdx,
-        int maxLen
+        long maxLen
         ){
 
     long depthMemAddr = 0;
     bool validFlag1 = false; 
     bool validFlag2 = false;
-    int currentLen = maxLen;
+    long currentLen = maxLen;
+    long len = maxLen;
     ramulator::Request::Type type = ramulator::Request::Type::READ;
 
     while(true){
+        // In sparse mode the first thread reads the frontier 
+        // queue, and the others have nothing to read.
         if(bfsIterationStart){
-            depthMemAddr = baseDepthMemAddr;
+            int slot = VertexProgram::getReadSlot(level);
+            depthMemAddr = baseDepthMemAddr + slot * vertexNum * (long)VertexProgram::getPropSize();
+            len = maxLen;
+            if(sparse){
+                depthMemAddr = getQueueAddr(queueIdx);
+                len = (prIdx == 0) ? curQueueSize * (long)sizeof(vidx_t) : 0;
+            }
             currentLen = 0;
             validFlag1 = true;
             validFlag2 = true;
         }
 
-        while(currentLen < maxLen){
+        while(currentLen < len){
             if(validFlag1){
                 if(GL::logon != 0){
                     std::cout << "Level = " << (int)level << " ";
@@ -111,14 +159,20 @@ void pe::inspectDepthReqThread(
                 validFlag1 = false;
             }
 
-            int actualLen = GL::baseLen;
-            if((currentLen + GL::baseLen) > maxLen){
-                actualLen = maxLen - currentLen;
+            int actualLen = getBaseLen(portIdx);
+            if((currentLen + actualLen) > len){
+                actualLen = len - currentLen;
             }
 
             int bufferSize = (int)(depthBuffer0[prIdx].size());
             int toBeSentSize = actualLen/sizeof(char);
-            if(bufferSize + toBeSentSize > GL::depthBufferDepth){
+            int bufferDepth = GL::depthBufferDepth;
+            if(sparse){
+                bufferSize = (int)(frontierBuffer.size());
+                toBeSentSize = actualLen/sizeof(vidx_t);
+                bufferDepth = GL::frontierBufferDepth;
+            }
+            if(bufferSize + toBeSentSize > bufferDepth){
                 wait(peClkCycle, SC_NS);
                 continue;
             }
@@ -132,6 +186,8 @@ void pe::inspectDepthReqThread(
             burstOpStatus[burstIdx] = false;
             depthMemAddr += actualLen;
             currentLen += actualLen;
+            splitBurstNum++;
+            splitBurstBytes += actualLen;
         }
 
         if(validFlag2){
@@ -150,8 +206,8 @@ void pe::inspectDepthReqThread(
 
 void pe::issueInspectDepthReadReq0(){
     int portIdx = 0; // portIdx = 0;
-    int maxLen = (GL::vertexNum/PRNUM) * (int)(sizeof(char));
-    long baseDepthMemAddr = GL::depthMemAddr; 
+    long maxLen = (vertexNum/PRNUM) * VertexProgram::getPropSize();
+    long baseDepthMemAddr = GL::partitions[peIdx].depthMemAddr; 
     int prIdx = 0;
     inspectDepthReqThread(
             baseDepthMemAddr,
@@ -163,8 +219,8 @@ void pe::issueInspectDepthReadReq0(){
 
 void pe::issueInspectDepthReadReq1(){
     int portIdx = 1;
-    int maxLen = GL::vertexNum/PRNUM * (int)(sizeof(char));
-    long baseDepthMemAddr = portIdx * (GL::vertexNum/PRNUM) * (int)(sizeof(char)); 
+    long maxLen = vertexNum/PRNUM * VertexProgram::getPropSize();
+    long baseDepthMemAddr = GL::partitions[peIdx].depthMemAddr + portIdx * (vertexNum/PRNUM) * VertexProgram::getPropSize(); 
     int prIdx = 1;
     inspectDepthReqThread(
             baseDepthMemAddr,
@@ -176,8 +232,8 @@ void pe::issueInspectDepthReadReq1(){
 
 void pe::issueInspectDepthReadReq2(){
     int portIdx = 2;
-    int maxLen = GL::vertexNum/PRNUM * (int)(sizeof(char));
-    long baseDepthMemAddr = portIdx * (GL::vertexNum/PRNUM) * (int)(sizeof(char)); 
+    long maxLen = vertexNum/PRNUM * VertexProgram::getPropSize();
+    long baseDepthMemAddr = GL::partitions[peIdx].depthMemAddr + portIdx * (vertexNum/PRNUM) * VertexProgram::getPropSize(); 
     int prIdx = 2;
     inspectDepthReqThread(
             baseDepthMemAddr,
@@ -189,8 +245,8 @@ void pe::issueInspectDepthReadReq2(){
 
 void pe::issueInspectDepthReadReq3(){
     int portIdx = 3;
-    int maxLen = (GL::vertexNum - portIdx * (GL::vertexNum/PRNUM)) * (int)(sizeof(char));
-    long baseDepthMemAddr = portIdx * (GL::vertexNum/PRNUM) * (int)(sizeof(char)); 
+    long maxLen = (vertexNum - portIdx * (vertexNum/PRNUM)) * VertexProgram::getPropSize();
+    long baseDepthMemAddr = GL::partitions[peIdx].depthMemAddr + portIdx * (vertexNum/PRNUM) * VertexProgram::getPropSize(); 
     int prIdx = 3;
     inspectDepthReqThread(
             baseDepthMemAddr,
@@ -201,18 +257,23 @@ void pe::issueInspectDepthReadReq3(){
 }
 
 void pe::inspectDepthRespThread(
-        int expectedLen,
+        long expectedLen,
         int portIdx,
         int prIdx
         ){
     bool validFlag1 = false; 
     bool validFlag2 = false;
-    int totalLen = 0;
+    long totalLen = 0;
+    long len = expectedLen;
     while(true){
         if(bfsIterationStart){
             validFlag1 = true;
             validFlag2 = true;
             totalLen = 0;
+            len = expectedLen;
+            if(sparse){
+                len = (prIdx == 0) ? curQueueSize * (long)sizeof(vidx_t) : 0;
+            }
         }
 
         if(burstRespQueue[portIdx].empty() == false){
@@ -228,10 +289,20 @@ void pe::inspectDepthRespThread(
 
             long burstIdx = burstRespQueue[portIdx].front();
             BurstOp* ptr = GL::bursts[burstIdx];
-            int num = ptr->length/((int)sizeof(char));
-            wait(num * peClkCycle, SC_NS);
-            burstOpStatus.erase(burstIdx);
-            ptr->burstReqToBuffer<char>(depthBuffer0[prIdx]);
+            if(sparse){
+                int num = ptr->length/((int)sizeof(vidx_t));
+                wait(num * peClkCycle, SC_NS);
+                burstOpStatus.erase(burstIdx);
+                ptr->burstReqToBuffer<vidx_t>(frontierBuffer);
+                frontierDepthBuffer.resize(frontierBuffer.size(), level);
+                queueReadLen += ptr->length;
+            }
+            else{
+                int num = ptr->length/VertexProgram::getPropSize();
+                wait(num * peClkCycle, SC_NS);
+                burstOpStatus.erase(burstIdx);
+                ptr->burstReqToBuffer<char>(depthBuffer0[prIdx]);
+            }
             burstRespQueue[portIdx].pop_front();
             totalLen += ptr->length;
         }
@@ -239,7 +310,7 @@ void pe::inspectDepthRespThread(
             wait(peClkCycle, SC_NS);
         }
 
-        if(validFlag2 && totalLen == expectedLen){
+        if(validFlag2 && totalLen == len){
             if(GL::logon != 0){
                 std::cout << "Level = " << (int)level << " ";
                 std::cout << "all depth of part " << prIdx;
@@ -253,7 +324,7 @@ void pe::inspectDepthRespThread(
 
 void pe::processInspectDepthReadResp0(){
     int portIdx = 0;
-    int expectedLen = (GL::vertexNum/PRNUM) * (int)(sizeof(char));
+    long expectedLen = (vertexNum/PRNUM) * VertexProgram::getPropSize();
     int prIdx = 0;
 
     inspectDepthRespThread(
@@ -265,7 +336,7 @@ void pe::processInspectDepthReadResp0(){
 
 void pe::processInspectDepthReadResp1(){
     int portIdx = 1;
-    int expectedLen = (GL::vertexNum/PRNUM) * (int)(sizeof(char));
+    long expectedLen = (vertexNum/PRNUM) * VertexProgram::getPropSize();
     int prIdx = 1;
 
     inspectDepthRespThread(
@@ -277,7 +348,7 @@ void pe::processInspectDepthReadResp1(){
 
 void pe::processInspectDepthReadResp2(){
     int portIdx = 2;
-    int expectedLen = (GL::vertexNum/PRNUM) * (int)(sizeof(char));
+    long expectedLen = (vertexNum/PRNUM) * VertexProgram::getPropSize();
     int prIdx = 2;
 
     inspectDepthRespThread(
@@ -289,7 +360,7 @@ void pe::processInspectDepthReadResp2(){
 
 void pe::processInspectDepthReadResp3(){
     int portIdx = 3;
-    int expectedLen = (GL::vertexNum - portIdx * (GL::vertexNum/PRNUM)) * (int)(sizeof(char));
+    long expectedLen = (vertexNum - portIdx * (vertexNum/PRNUM)) * VertexProgram::getPropSize();
     int prIdx = 3;
 
     inspectDepthRespThread(
@@ -305,10 +376,10 @@ void pe::inspectDepthAnalysis(){
     bool validFlag2 = false;
     bfsDone.write(false);
 
-    int idx[PRNUM];
-    auto resetIdx = [](int idx[PRNUM]){
+    long idx[PRNUM];
+    auto resetIdx = [this](long idx[PRNUM]){
         for(int i = 0; i < PRNUM; i++){
-            idx[i] = i * (GL::vertexNum/PRNUM);
+            idx[i] = vertexBegin + i * (vertexNum/PRNUM);
         }
     };
     resetIdx(idx);
@@ -318,7 +389,8 @@ void pe::inspectDepthAnalysis(){
             resetIdx(idx);
             validFlag1 = true;
             validFlag2 = true;
-            frontierSize = 0;
+            frontierSize = sparse ? curQueueSize : 0;
+            inspectDone = false;
         }
 
         bool notEmpty = false;
@@ -341,10 +413,11 @@ void pe::inspectDepthAnalysis(){
 
             for(int i = 0; i < PRNUM; i++){
                 if(depthBuffer0[i].empty() == false){
-                    char d = depthBuffer0[i].front();
-                    depthBuffer0[i].pop_front();
-                    if(d == level){
+                    prop_t value;
+                    prop_t prop = popProp(depthBuffer0[i]);
+                    if(VertexProgram::isActive(prop, level, value)){
                         frontierBuffer.push_back(idx[i]);
+                        frontierDepthBuffer.push_back(value);
                         frontierSize++;
                     }
                     idx[i]++;
@@ -355,12 +428,15 @@ void pe::inspectDepthAnalysis(){
         bool allAnalyzed = true;
         for(int i = 0; i < PRNUM; i++){
             if(i < PRNUM - 1){
-                allAnalyzed &= (idx[i] == (i+1) * (GL::vertexNum/PRNUM));
+                allAnalyzed &= (idx[i] == vertexBegin + (i+1) * (vertexNum/PRNUM));
             }
             else{
-                allAnalyzed &= (idx[i] == GL::vertexNum);
+                allAnalyzed &= (idx[i] == vertexBegin + vertexNum);
             }
         }
+        if(sparse){
+            allAnalyzed = (queueReadLen == curQueueSize * (long)sizeof(vidx_t));
+        }
 
         if(allAnalyzed && validFlag2){
             if(GL::logon != 0){
@@ -369,23 +445,83 @@ void pe::inspectDepthAnalysis(){
                 std::cout << sc_time_stamp() << std::endl;
             }
             validFlag2 = false;
+            inspectDone = true;
 
-            // bfs complete
-            if(frontierSize == 0){
+            // bfs complete, which is detected by the last pe 
+            // that completes the inspection.
+            if(isFrontierEmpty()){
                 std::cout << "Empty frontier is detected." << std::endl;
-                double runtime = (long)(sc_time_stamp()/sc_time(1, SC_NS))/1000;
-                std::cout << "BFS performance is " << GL::edgeNum/runtime;
-                std::cout << " billion traverse per second." << std::endl;
-                std::cout << "This is the end of the BFS traverse." << std::endl;
-                bfsDone.write(true);
+                reportBfs();
+                bfsComplete = true;
                 //sc_stop();
             }
         }
 
+        // Only the first pe drives the bfsDone signal.
+        if(bfsComplete && peIdx == 0 && bfsDone.read() == false){
+            bfsDone.write(true);
+        }
+
         wait(peClkCycle, SC_NS);
     }
 }
 
+// The performance and the optional statistics at the end of bfs.
+void pe::reportBfs(){
+    GL::bfsRuntime = GL::getTimeStamp();
+    double runtime = GL::bfsRuntime/1000;
+    if(GL::algorithm == Algorithm::BFS){
+        std::cout << "BFS performance is " << GL::edgeNum/runtime;
+        std::cout << " billion traverse per second." << std::endl;
+    }
+    else{
+        // The other algorithms are measured with the edges streamed.
+        long edges = 0;
+        for(auto p : peGroup){
+            edges += p->ciaoDecodedNum;
+        }
+        std::cout << VertexProgram::getName() << " performance is " << edges/runtime;
+        std::cout << " billion edges per second." << std::endl;
+    }
+    reportCiaoTraffic();
+    if(GL::adaptiveBaseLen != 0){
+        long num = 0;
+        long bytes = 0;
+        for(auto p : peGroup){
+            num += p->splitBurstNum;
+            bytes += p->splitBurstBytes;
+        }
+        std::cout << "average split burst length: ";
+        std::cout << (num > 0 ? bytes / num : 0) << " bytes" << std::endl;
+    }
+    if(GL::frontierMode != FrontierMode::DENSE){
+        std::cout << "sparse frontier levels: " << sparseLevelNum;
+        std::cout << " of " << (int)level + 1 << std::endl;
+    }
+    if(GL::reqQueueDepth > 0){
+        std::cout << "request stall cycles per port:";
+        for(int i = 0; i < PNUM; i++){
+            long cycles = 0;
+            for(auto p : peGroup){
+                cycles += p->stallCycles[i];
+            }
+            std::cout << " " << cycles;
+        }
+        std::cout << std::endl;
+    }
+    if(VertexProgram::isAsync()){
+        long expanded = 0;
+        long corrected = 0;
+        for(auto p : peGroup){
+            expanded += p->expandedNum;
+            corrected += p->correctedNum;
+        }
+        std::cout << "async bfs expanded vertices: " << expanded;
+        std::cout << ", corrected depths: " << corrected << std::endl;
+    }
+    std::cout << "This is the end of the BFS traverse." << std::endl;
+}
+
 // Analyze frontier and load corresponding rpao from memory.
 void pe::frontierAnalysis(){
     ramulator::Request::Type type = ramulator::Request::Type::READ;
@@ -397,6 +533,23 @@ void pe::frontierAnalysis(){
             validFlag1 = true;
         }
 
+        // The asynchronous bfs takes the vertices from the lowest bucket 
+        // of the work queue, and drops the ones whose depth has been 
+        // lowered again since they were queued.
+        if(VertexProgram::isAsync() && frontierBuffer.empty() && workBuckets.empty() == false){
+            auto bucket = workBuckets.begin();
+            vidx_t vidx = bucket->second.front();
+            bucket->second.pop_front();
+            auto it = pendingDepth.find(vidx);
+            if(it == pendingDepth.end() || it->second.first == -1 || it->second.first >= bucket->first){
+                frontierBuffer.push_back(vidx);
+                frontierDepthBuffer.push_back(bucket->first);
+            }
+            if(bucket->second.empty()){
+                workBuckets.erase(bucket);
+            }
+        }
+
         if(frontierBuffer.empty() == false && 
            ((int)rpaoBuffer.size() + 2 < GL::rpaoBufferDepth))
         {
@@ -409,10 +562,17 @@ void pe::frontierAnalysis(){
                 validFlag1 = false;
             }
 
-            int vidx = frontierBuffer.front();
+            vidx_t vidx = frontierBuffer.front();
             frontierBuffer.pop_front();
-            long rpaoMemAddr = GL::rpaoMemAddr + vidx * sizeof(int);
-            int len = sizeof(int) * 2;
+            rpaoDepthBuffer.push_back(frontierDepthBuffer.front());
+            frontierDepthBuffer.pop_front();
+            expandedNum++;
+            if((int)GL::frontierSizes.size() <= level){
+                GL::frontierSizes.resize(level + 1, 0);
+            }
+            GL::frontierSizes[level]++;
+            long rpaoMemAddr = GL::partitions[peIdx].rpaoMemAddr + (vidx - vertexBegin) * (long)sizeof(eidx_t);
+            int len = sizeof(eidx_t) * 2;
             long burstIdx = createReadBurstReq(type, portIdx, rpaoMemAddr, len);
             burstOpStatus[burstIdx] = false;
         }
@@ -443,12 +603,12 @@ void pe::processExpandRpaoReadResp(){
 
             long burstIdx = burstRespQueue[portIdx].front();
             BurstOp* ptr = GL::bursts[burstIdx];
-            int num = ptr->length/sizeof(int);
+            int num = ptr->length/sizeof(eidx_t);
             wait(num * peClkCycle, SC_NS);
 
             //burstOpStatus[burstIdx] = true;
             burstOpStatus.erase(burstIdx);
-            ptr->burstReqToBuffer<int>(rpaoBuffer);
+            ptr->burstReqToBuffer<eidx_t>(rpaoBuffer);
             burstRespQueue[portIdx].pop_front();
         }
         else{
@@ -478,27 +638,50 @@ void pe::issueExpandCiaoReadReq(){
                 validFlag1 = false;
             }
 
-            int srcIdx = rpaoBuffer.front();
+            eidx_t srcIdx = rpaoBuffer.front();
             rpaoBuffer.pop_front();
-            int dstIdx = rpaoBuffer.front();
+            eidx_t dstIdx = rpaoBuffer.front();
             rpaoBuffer.pop_front();
-            long ciaoMemAddr = GL::ciaoMemAddr + srcIdx * sizeof(int);
-            int maxLen = sizeof(int) * (dstIdx - srcIdx);
+            prop_t value = rpaoDepthBuffer.front();
+            rpaoDepthBuffer.pop_front();
+            if(dstIdx > srcIdx){
+                ciaoListDepth.push_back(VertexProgram::scatter(value, dstIdx - srcIdx));
+            }
+            // The compressed lists are addressed in bytes.
+            bool compressed = (GL::ciaoFormat != CiaoFormat::RAW);
+            int edgeSize = VertexProgram::getEdgeSize();
+            long ciaoMemAddr = GL::partitions[peIdx].ciaoMemAddr + srcIdx * (long)edgeSize;
+            long maxLen = (long)edgeSize * (dstIdx - srcIdx);
+            if(compressed){
+                ciaoMemAddr = GL::partitions[peIdx].ciaoMemAddr + srcIdx;
+                maxLen = dstIdx - srcIdx;
+                if(maxLen > 0){
+                    ciaoLenBuffer.push_back(maxLen);
+                }
+            }
+            else if(maxLen > 0){
+                ciaoListNum.push_back(dstIdx - srcIdx);
+            }
 
-            int len = 0;
+            long len = 0;
             while(len < maxLen){
-                int actualLen = GL::baseLen;
-                if(len + GL::baseLen > maxLen){
+                int actualLen = getBaseLen(portIdx);
+                if(len + actualLen > maxLen){
                     actualLen = maxLen - len;
                 }
 
                 int bufferSize = (int)ciaoBuffer.size();
-                int toBeSentSize = actualLen / (int)sizeof(int);
+                int toBeSentSize = actualLen / edgeSize;
+                if(compressed){
+                    bufferSize = (int)ciaoByteBuffer.size() / (int)sizeof(vidx_t);
+                }
                 if(bufferSize + toBeSentSize < GL::ciaoBufferDepth){
                     long burstIdx = createReadBurstReq(type, portIdx, ciaoMemAddr, actualLen);
                     burstOpStatus[burstIdx] = false;
                     ciaoMemAddr += actualLen;
                     len += actualLen;
+                    splitBurstNum++;
+                    splitBurstBytes += actualLen;
                 }
                 else{
                     wait(peClkCycle, SC_NS);
@@ -531,11 +714,35 @@ void pe::processExpandCiaoReadResp(){
 
             long burstIdx = burstRespQueue[portIdx].front();
             BurstOp* ptr = GL::bursts[burstIdx];
-            int num = ptr->length/(int)sizeof(int);
+            int num = (ptr->length + (int)sizeof(vidx_t) - 1)/(int)sizeof(vidx_t);
             wait(num * peClkCycle, SC_NS);
             //burstOpStatus[burstIdx] = true;
             burstOpStatus.erase(burstIdx);
-            ptr->burstReqToBuffer<int>(ciaoBuffer);
+            if(GL::ciaoFormat != CiaoFormat::RAW){
+                ptr->burstReqToBuffer<char>(ciaoByteBuffer);
+            }
+            else{
+                // The weighted neighbours are followed by their weights.
+                std::list<vidx_t> words;
+                ptr->burstReqToBuffer<vidx_t>(words);
+                bool weighted = VertexProgram::getEdgeSize() > (int)sizeof(vidx_t);
+                while(words.empty() == false){
+                    int weight = 0;
+                    ciaoBuffer.push_back(words.front());
+                    words.pop_front();
+                    if(weighted){
+                        weight = words.front();
+                        words.pop_front();
+                    }
+                    ciaoDepthBuffer.push_back(VertexProgram::traverse(ciaoListDepth.front(), weight));
+                    ciaoDecodedNum++;
+                    if(--ciaoListNum.front() == 0){
+                        ciaoListNum.pop_front();
+                        ciaoListDepth.pop_front();
+                    }
+                }
+            }
+            ciaoReadBytes += ptr->length;
             burstRespQueue[portIdx].pop_front();
         }
         else{
@@ -544,6 +751,91 @@ void pe::processExpandCiaoReadResp(){
     }
 }
 
+// Decode the compressed ciao. The decoder consumes up to 
+// ciaoDecodeRate bytes per cycle while there is room in ciaoBuffer.
+void pe::decodeExpandCiao(){
+    bool validFlag1 = false;
+    while(true){
+        if(bfsIterationStart){
+            validFlag1 = true;
+        }
+
+        if(ciaoByteBuffer.empty() == false && 
+           (int)ciaoBuffer.size() < GL::ciaoBufferDepth)
+        {
+            if(validFlag1){
+                if(GL::logon != 0){
+                    std::cout << "Level = " << (int)level << " ";
+                    std::cout << "decode ciao at ";
+                    std::cout << sc_time_stamp() << std::endl;
+                }
+                validFlag1 = false;
+            }
+
+            int bufferSize = (int)ciaoBuffer.size();
+            for(int i = 0; i < GL::ciaoDecodeRate && ciaoByteBuffer.empty() == false; i++){
+                if(ciaoDecoder.isIdle()){
+                    ciaoDecoder.start(GL::ciaoFormat, ciaoLenBuffer.front());
+                    ciaoLenBuffer.pop_front();
+                    decodeDepth = ciaoListDepth.front();
+                    ciaoListDepth.pop_front();
+                }
+                ciaoDecoder.decodeByte((uint8_t)ciaoByteBuffer.front(), ciaoBuffer);
+                ciaoDepthBuffer.resize(ciaoBuffer.size(), decodeDepth);
+                ciaoByteBuffer.pop_front();
+            }
+            ciaoDecodedNum += (int)ciaoBuffer.size() - bufferSize;
+            ciaoDecodeCycles++;
+        }
+
+        wait(peClkCycle, SC_NS);
+    }
+}
+
+// The ciao traffic of all the pes is compared to the raw 
+// indices that are decoded. The decoders work in parallel, 
+// so the decode cycles are the largest of the pes.
+void pe::reportCiaoTraffic(){
+    long decodedNum = 0;
+    long remoteNum = 0;
+    GL::ciaoReadBytes = 0;
+    GL::ciaoDecodeCycles = 0;
+    for(auto p : peGroup){
+        GL::ciaoReadBytes += p->ciaoReadBytes;
+        GL::ciaoDecodeCycles = std::max(GL::ciaoDecodeCycles, p->ciaoDecodeCycles);
+        decodedNum += p->ciaoDecodedNum;
+        remoteNum += p->remoteUpdateNum;
+    }
+
+    std::cout << "ciao read bytes: " << GL::ciaoReadBytes << std::endl;
+    if(GL::ciaoFormat != CiaoFormat::RAW){
+        long rawBytes = decodedNum * (long)sizeof(vidx_t);
+        std::cout << "ciao raw bytes: " << rawBytes << ", ";
+        std::cout << "saved " << 100.0 * (rawBytes - GL::ciaoReadBytes) / rawBytes << "%" << std::endl;
+        std::cout << "ciao decode cycles: " << GL::ciaoDecodeCycles << std::endl;
+    }
+    if(GL::peNum > 1){
+        std::cout << "remote depth updates: " << remoteNum << " of " << decodedNum << std::endl;
+    }
+}
+
+// The vertices from the other pes join the local neighbours 
+// to be checked once they arrive.
+void pe::processRemoteUpdate(){
+    while(true){
+        if(remoteVidxBuffer.empty() == false && 
+           remoteVidxBuffer.front().first <= GL::getTimeStamp() &&
+           (int)ciaoBuffer.size() < GL::ciaoBufferDepth)
+        {
+            ciaoBuffer.push_back(remoteVidxBuffer.front().second);
+            ciaoDepthBuffer.push_back(remoteDepthBuffer.front());
+            remoteVidxBuffer.pop_front();
+            remoteDepthBuffer.pop_front();
+        }
+        wait(peClkCycle, SC_NS);
+    }
+}
+
 // Read depth
 void pe::issueExpandDepthReadReq(){
     ramulator::Request::Type type = ramulator::Request::Type::READ;
@@ -555,8 +847,10 @@ void pe::issueExpandDepthReadReq(){
             validFlag1 = true;
         }
 
+        // The depth reads in flight are bounded rather than ciaoBuffer, 
+        // which the decoder and the remote updates may fill up.
         if(ciaoBuffer.empty() == false && 
-           ((int)(ciaoBuffer.size())) < GL::depthBufferDepth)
+           (int)vidxBuffer.size() < GL::depthBufferDepth)
         {
             if(validFlag1){
                 if(GL::logon != 0){
@@ -567,11 +861,33 @@ void pe::issueExpandDepthReadReq(){
                 validFlag1 = false;
             }
 
-            int vidx = ciaoBuffer.front();
+            // The depth of the vertices in the other partitions 
+            // is updated by the owner pe.
+            vidx_t vidx = ciaoBuffer.front();
+            prop_t value = ciaoDepthBuffer.front();
+            int owner = GL::getPartitionIdx(vidx);
+            if(owner != peIdx){
+                long arriveTime = GL::getTimeStamp() + (long)(GL::msgLatency * peClkCycle * 1000);
+                peGroup[owner]->remoteVidxBuffer.push_back(std::make_pair(arriveTime, vidx));
+                peGroup[owner]->remoteDepthBuffer.push_back(value);
+                ciaoBuffer.pop_front();
+                ciaoDepthBuffer.pop_front();
+                remoteUpdateNum++;
+                wait(peClkCycle, SC_NS);
+                continue;
+            }
+
+            int propSize = VertexProgram::getPropSize();
+            long depthMemAddr = GL::getDepthMemAddr(vidx, VertexProgram::getWriteSlot(level));
             vidxBuffer.push_back(vidx);
+            vidxDepthBuffer.push_back(value);
             ciaoBuffer.pop_front();
-            long depthMemAddr = GL::depthMemAddr + vidx * sizeof(char);
-            long burstIdx = createReadBurstReq(type, portIdx, depthMemAddr, 1);
+            ciaoDepthBuffer.pop_front();
+            if(VertexProgram::isForwarded()){
+                auto it = pendingDepth.insert(std::make_pair(vidx, std::make_pair((prop_t)-1, 0))).first;
+                it->second.second++;
+            }
+            long burstIdx = createReadBurstReq(type, portIdx, depthMemAddr, propSize);
             burstOpStatus[burstIdx] = false;
         }
         else{
@@ -601,7 +917,7 @@ void pe::processExpandDepthReadResp(){
 
             long burstIdx = burstRespQueue[portIdx].front();
             BurstOp* ptr = GL::bursts[burstIdx];
-            int num = ptr->length/(int)sizeof(char);
+            int num = ptr->length/VertexProgram::getPropSize();
             wait(num * peClkCycle, SC_NS);
             //burstOpStatus[ptr->burstIdx] = true;
             burstOpStatus.erase(ptr->burstIdx);
@@ -636,22 +952,61 @@ void pe::expandDepthAnalysis(){
                 validFlag1 = false;
             }
 
-            int d = depthBuffer1.front();
-            int vidx = vidxBuffer.front();
-            depthBuffer1.pop_front();
+            prop_t prop = popProp(depthBuffer1);
+            vidx_t vidx = vidxBuffer.front();
+            prop_t value = vidxDepthBuffer.front();
             vidxBuffer.pop_front();
-            if(d == -1){
-                d = level + 1;
-                depthBuffer2.push_back(d);
-                long depthMemAddr = GL::depthMemAddr + vidx * sizeof(char);
+            vidxDepthBuffer.pop_front();
+
+            // The property being written is newer than the one read.
+            std::pair<prop_t, int>* pending = NULL;
+            if(VertexProgram::isForwarded()){
+                pending = &pendingDepth[vidx];
+                if(pending->first != -1){
+                    prop = pending->first;
+                }
+            }
+
+            prop_t old = prop;
+            if(VertexProgram::apply(prop, value, level)){
+                // A bfs depth beyond INT8_MAX would wrap around to a
+                // negative depth, which wins every later comparison.
+                if(GL::algorithm == Algorithm::BFS && prop > INT8_MAX){
+                    HERE;
+                    std::cout << "The bfs depth " << (long)prop << " of vertex " << vidx;
+                    std::cout << " does not fit the int8_t depth." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                if(old != VertexProgram::getInitProp(vidx)){
+                    correctedNum++;
+                }
+                if(pending != NULL){
+                    pending->first = prop;
+                    pending->second++;
+                }
+                pushProp(depthBuffer2, prop);
+                int propSize = VertexProgram::getPropSize();
+                long depthMemAddr = GL::getDepthMemAddr(vidx, VertexProgram::getWriteSlot(level));
                 int burstIdx = createWriteBurstReq<char>(
                     type, 
                     portIdx, 
                     depthMemAddr, 
-                    1, 
+                    propSize, 
                     depthBuffer2);
 
                 burstOpStatus[burstIdx] = false;
+                if(pending != NULL){
+                    asyncWrites[burstIdx] = vidx;
+                }
+                if(VertexProgram::isAsync()){
+                    workBuckets[prop].push_back(vidx);
+                }
+                else if(GL::frontierMode != FrontierMode::DENSE){
+                    appendNextFrontier(vidx);
+                }
+            }
+            if(pending != NULL){
+                releasePendingDepth(vidx);
             }
         }
         else{
@@ -683,6 +1038,60 @@ void pe::processExpandDepthWriteResp(){
             //burstOpStatus[ptr->burstIdx] = true;
             burstOpStatus.erase(ptr->burstIdx);
             burstRespQueue[portIdx].pop_front();
+
+            auto write = asyncWrites.find(burstIdx);
+            if(write != asyncWrites.end()){
+                releasePendingDepth(write->second);
+                asyncWrites.erase(write);
+            }
+        }
+        else{
+            wait(peClkCycle, SC_NS);
+        }
+    }
+}
+
+// The vertices are appended to the next frontier queue. A vertex may be 
+// appended twice when its depth is read again before the first write 
+// lands, so the queue may overflow and the next level falls back to the 
+// depth scan.
+void pe::appendNextFrontier(vidx_t vidx){
+    int slot = (level + 1) & 1;
+    if(nextQueued[vidx - vertexBegin]){
+        return;
+    }
+    nextQueued[vidx - vertexBegin] = true;
+    if(nextQueueSize == vertexNum){
+        queueOverflow[slot] = true;
+        return;
+    }
+    frontierWriteBuffer.push_back(vidx);
+    nextQueueSize++;
+    queueTotal[slot]++;
+}
+
+// The queued vertices are written in full bursts, and the remaining 
+// ones are written when nothing else is in flight.
+void pe::issueFrontierWriteReq(){
+    ramulator::Request::Type type = ramulator::Request::Type::WRITE;
+    int portIdx = 7;
+    int burstNum = GL::burstLen / (int)sizeof(vidx_t);
+    int maxNum = GL::getBaseLen(portIdx) / (int)sizeof(vidx_t);
+
+    while(true){
+        int num = (int)frontierWriteBuffer.size();
+        if(num >= burstNum || (num > 0 && isExpandDrained())){
+            num = std::min(num, maxNum);
+            long addr = getQueueAddr(queueIdx ^ 1) + nextQueueWritten * (long)sizeof(vidx_t);
+            long burstIdx = createWriteBurstReq<vidx_t>(
+                    type, 
+                    portIdx, 
+                    addr, 
+                    num * (int)sizeof(vidx_t), 
+                    frontierWriteBuffer);
+
+            burstOpStatus[burstIdx] = false;
+            nextQueueWritten += num;
         }
         else{
             wait(peClkCycle, SC_NS);
@@ -690,6 +1099,67 @@ void pe::processExpandDepthWriteResp(){
     }
 }
 
+// The long streams are split into shorter bursts when the memory read 
+// queues fill up or the random depth reads are in flight, so that the 
+// depth reads don't wait behind the long bursts. The length is kept a 
+// multiple of the memory burst.
+int pe::getBaseLen(int portIdx){
+    int len = GL::getBaseLen(portIdx);
+    if(GL::adaptiveBaseLen == 0){
+        return len;
+    }
+
+    int shift = 0;
+    if(GL::memQueueOccupancy >= 0.75){
+        shift = 2;
+    }
+    else if(GL::memQueueOccupancy >= 0.5){
+        shift = 1;
+    }
+    if(vidxBuffer.empty() == false){
+        shift++;
+    }
+    len = (len >> shift) / GL::burstLen * GL::burstLen;
+    return std::max(len, GL::burstLen);
+}
+
+long pe::getQueueAddr(int q){
+    return GL::partitions[peIdx].frontierMemAddr + q * vertexNum * (long)sizeof(vidx_t);
+}
+
+// The next queue becomes the current one. All the pes see the same 
+// queue size and overflow of the level, and thus pick the same mode.
+void pe::startLevel(){
+    int slot = level & 1;
+    queueIdx ^= 1;
+    curQueueSize = nextQueueSize;
+    nextQueueSize = 0;
+    nextQueueWritten = 0;
+    queueReadLen = 0;
+    nextQueued.assign(vertexNum, false);
+    queueTotal[slot ^ 1] = 0;
+    queueOverflow[slot ^ 1] = false;
+
+    if(GL::frontierMode == FrontierMode::DENSE || queueOverflow[slot]){
+        sparse = false;
+    }
+    else if(GL::frontierMode == FrontierMode::SPARSE){
+        sparse = true;
+    }
+    else{
+        sparse = queueTotal[slot] * (double)sizeof(vidx_t) < GL::sparseThreshold * GL::vertexNum;
+    }
+
+    if(peIdx == 0 && sparse){
+        sparseLevelNum++;
+    }
+    if(peIdx == 0 && GL::logon != 0 && GL::frontierMode != FrontierMode::DENSE){
+        std::cout << "Level = " << (int)level << " ";
+        std::cout << (sparse ? "sparse" : "dense") << " frontier of ";
+        std::cout << queueTotal[slot] << " vertices" << std::endl;
+    }
+}
+
 void pe::bfsController(){
     if(localCounter < 20){
         localCounter++;
@@ -697,11 +1167,23 @@ void pe::bfsController(){
 
     if(localCounter == 10){
         bfsIterationStart = true;
+        startLevel();
     }
     else{
         bfsIterationStart = false;
     }
 
+    // The asynchronous bfs stays at level 0, and it completes when all 
+    // the pes are idle with no work queued.
+    if(VertexProgram::isAsync()){
+        if(localCounter == 20 && bfsComplete == false && isAsyncDone()){
+            std::cout << "Asynchronous bfs completes." << std::endl;
+            reportBfs();
+            bfsComplete = true;
+        }
+        return;
+    }
+
     if(isEndOfBfsIteration() && localCounter == 20){
         burstOpStatus.clear();
         level++;
@@ -713,7 +1195,27 @@ void pe::bfsController(){
 
 }
 
+// The bfs iteration ends when all the pes are idle.
 bool pe::isEndOfBfsIteration(){
+    bool isIterationEnd = true;
+    for(auto p : peGroup){
+        isIterationEnd &= p->isEndOfLocalIteration();
+    }
+    return isIterationEnd;
+}
+
+// The frontier is empty when all the pes have inspected 
+// their partitions and found no vertex at current level.
+bool pe::isFrontierEmpty(){
+    bool empty = true;
+    for(auto p : peGroup){
+        empty &= p->inspectDone;
+        empty &= (p->frontierSize == 0);
+    }
+    return empty;
+}
+
+bool pe::isEndOfLocalIteration(){
     bool isIterationEnd = true;
     isIterationEnd &= isBurstReqQueueEmpty();
     isIterationEnd &= isBurstRespQueueEmpty();
@@ -724,12 +1226,73 @@ bool pe::isEndOfBfsIteration(){
     isIterationEnd &= frontierBuffer.empty();
     isIterationEnd &= rpaoBuffer.empty();
     isIterationEnd &= ciaoBuffer.empty();
+    isIterationEnd &= ciaoByteBuffer.empty();
+    isIterationEnd &= ciaoLenBuffer.empty();
+    isIterationEnd &= ciaoDecoder.isIdle();
+    isIterationEnd &= remoteVidxBuffer.empty();
     isIterationEnd &= depthBuffer1.empty();
     isIterationEnd &= depthBuffer2.empty();
+    isIterationEnd &= frontierWriteBuffer.empty();
 
     return isIterationEnd;
 }
 
+// Nothing but the frontier queue writes is left in the pe.
+bool pe::isExpandDrained(){
+    for(const auto &op : burstOpStatus){
+        if(GL::bursts[op.first]->type == ramulator::Request::Type::READ){
+            return false;
+        }
+    }
+    bool drained = true;
+    drained &= frontierBuffer.empty();
+    drained &= rpaoBuffer.empty();
+    drained &= ciaoBuffer.empty();
+    drained &= ciaoByteBuffer.empty();
+    drained &= ciaoLenBuffer.empty();
+    drained &= remoteVidxBuffer.empty();
+    drained &= depthBuffer1.empty();
+    drained &= vidxBuffer.empty();
+    return drained;
+}
+
+bool pe::isAsyncDone(){
+    bool done = true;
+    for(auto p : peGroup){
+        done &= p->inspectDone;
+        done &= p->workBuckets.empty();
+        done &= p->isEndOfLocalIteration();
+    }
+    return done;
+}
+
+// The entry is dropped once no read or write of the vertex is in flight.
+void pe::releasePendingDepth(vidx_t vidx){
+    auto it = pendingDepth.find(vidx);
+    it->second.second--;
+    if(it->second.second == 0){
+        pendingDepth.erase(it);
+    }
+}
+
+// The properties are moved through the byte buffers of the depth.
+prop_t pe::popProp(std::list<char> &buffer){
+    char bytes[sizeof(prop_t)];
+    for(int i = 0; i < VertexProgram::getPropSize(); i++){
+        bytes[i] = buffer.front();
+        buffer.pop_front();
+    }
+    return VertexProgram::getProp(bytes);
+}
+
+void pe::pushProp(std::list<char> &buffer, prop_t prop){
+    char bytes[sizeof(prop_t)];
+    VertexProgram::setProp(bytes, prop);
+    for(int i = 0; i < VertexProgram::getPropSize(); i++){
+        buffer.push_back(bytes[i]);
+    }
+}
+
 long pe::createReadBurstReq(
         ramulator::Request::Type type, 
         int portIdx,
@@ -742,19 +1305,36 @@ long pe::createReadBurstReq(
     ptr->updateAddrVec();
     GL::bursts.push_back(ptr);
 
+    // The burst is registered before the wait, or the bfs iteration may 
+    // be considered complete while it is being created.
+    burstOpStatus[burstIdx] = false;
     wait(peClkCycle, SC_NS);
+    waitReqSlot(portIdx);
     burstReqQueue[portIdx].push_back(burstIdx);
     
     return burstIdx;
 }
 
+// With a bounded reqQueueDepth, the burst at the head of a port is sent 
+// when the port holds the credits of all its requests. A burst longer 
+// than the queue is sent when the queue of the port is empty.
 void pe::sendMemReq(){ 
     while(true){
         for(int i = 0; i < PNUM; i++){
+            reqCredits[i] += reqCredit[i].read();
             if(burstReqQueue[i].empty() == false){
                 long burstIdx = burstReqQueue[i].front(); 
                 BurstOp* ptr = GL::bursts[burstIdx];
-                long departTime = (long)(sc_time_stamp()/sc_time(1, SC_NS));
+                if(GL::reqQueueDepth > 0){
+                    int reqNum = ptr->getReqNum();
+                    if(reqCredits[i] < reqNum && reqCredits[i] < GL::reqQueueDepth){
+                        burstReq[i].write(-1);
+                        stallCycles[i]++;
+                        continue;
+                    }
+                    reqCredits[i] -= reqNum;
+                }
+                long departTime = GL::getTimeStamp();
                 ptr->departPeTime = departTime;
                 burstReq[i].write(burstIdx);
                 burstReqQueue[i].pop_front();
@@ -776,6 +1356,14 @@ bool pe::isBurstReqQueueEmpty(){
     return empty;
 }
 
+// The stall reaches the threads issuing the bursts. A port holds 
+// at most one burst waiting for the credits.
+void pe::waitReqSlot(int portIdx){
+    while(GL::reqQueueDepth > 0 && burstReqQueue[portIdx].empty() == false){
+        wait(peClkCycle, SC_NS);
+    }
+}
+
 bool pe::isBurstRespQueueEmpty(){
     bool empty = true;
     for(const auto &v : burstRespQueue){
@@ -789,7 +1377,7 @@ void pe::getMemResp(){
         for(int i = 0; i < PNUM; i++){
             long burstIdx = burstResp[i].read();
             if(burstIdx != -1){
-                long arriveTime = (long)(sc_time_stamp()/sc_time(1, SC_NS));
+                long arriveTime = GL::getTimeStamp();
                 GL::bursts[burstIdx]->arrivePeTime = arriveTime;
                 burstRespQueue[i].push_back(burstIdx);
             } 
@@ -798,7 +1386,7 @@ void pe::getMemResp(){
     }
 }
 
-void pe::setPeClkCycle(int _peClkCycle){
+void pe::setPeClkCycle(double _peClkCycle){
     peClkCycle = _peClkCycle;
 }
 
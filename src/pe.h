@@ -7,6 +7,8 @@
 #include <map>
 #include "Request.h"
 #include "common.h"
+#include "codec.h"
+#include "program.h"
 #include "systemc.h"
 
 class pe : public sc_module{
@@ -16,15 +18,16 @@ class pe : public sc_module{
     public:
         sc_out<long> burstReq[PNUM];
         sc_in<long> burstResp[PNUM];
+        sc_in<long> reqCredit[PNUM];
         sc_in<bool> peClk;
         sc_out<bool> bfsDone;
 
         int peIdx;
-        pe(sc_module_name _name, int _peIdx, int _peClkCycle);
+        pe(sc_module_name _name, int _peIdx, double _peClkCycle);
         ~pe(){};
 
 
-        void setPeClkCycle(int _peClkCycle);
+        void setPeClkCycle(double _peClkCycle);
 
         // As it takes time to write data to memory, even though the write requests 
         // can always be accommodated. Thus we add additional delay here to simulate 
@@ -38,6 +41,8 @@ class pe : public sc_module{
                 std::list<T> &buffer
                 )
         {
+            // The data stays in the buffer while the port is stalled.
+            waitReqSlot(portIdx);
             long burstIdx = GL::getBurstIdx();
             BurstOp* ptr = new BurstOp(type, portIdx, burstIdx, peIdx, addr, length);
             ptr->updateReqVec();
@@ -65,8 +70,19 @@ class pe : public sc_module{
 
     private:
         char level;
-        int peClkCycle;
+        double peClkCycle;
         int frontierSize;
+        bool inspectDone;
+
+        // The vertices [vertexBegin, vertexBegin + vertexNum) of the 
+        // partition owned by the pe.
+        long vertexBegin;
+        long vertexNum;
+
+        // All the pes, which advance the bfs level together. The bfs 
+        // completes when the frontier of all the partitions is empty.
+        static std::vector<pe*> peGroup;
+        static bool bfsComplete;
         bool bfsIterationStart;
         int localCounter;
         bool topdown;
@@ -75,12 +91,83 @@ class pe : public sc_module{
         std::list<char> depthBuffer1;   //expandDepthWriteBuffer;
         std::list<char> depthBuffer2;   //expandDepthReadBuffer;
 
-        std::list<int> frontierBuffer;  //inspectFrontierBuffer;
-        std::list<int> rpaoBuffer;      //expandRpaoReadBuffer;
-        std::list<int> ciaoBuffer;      //expandCiaoReadBuffer;
-        std::list<int> rpaiBuffer;      //exapndRpaiReadBuffer; 
-        std::list<int> ciaiBuffer;      //expandCiaiReadBuffer;  
-        std::list<int> vidxBuffer;      //expandVidxForDepthWriteBuffer;
+        std::list<vidx_t> frontierBuffer;  //inspectFrontierBuffer;
+        std::list<eidx_t> rpaoBuffer;      //expandRpaoReadBuffer;
+        std::list<vidx_t> ciaoBuffer;      //expandCiaoReadBuffer;
+        std::list<eidx_t> rpaiBuffer;      //exapndRpaiReadBuffer; 
+        std::list<vidx_t> ciaiBuffer;      //expandCiaiReadBuffer;  
+        std::list<vidx_t> vidxBuffer;      //expandVidxForDepthWriteBuffer;
+
+        // Each vertex carries its value through the expansion. The 
+        // frontier vertices and the vertices whose rpao is read keep 
+        // the value of their property, and the neighbours keep the value 
+        // to be applied to their property. ciaoListDepth and ciaoListNum 
+        // keep the scattered value and the # of neighbours (raw ciao 
+        // only) of each requested list.
+        std::list<prop_t> frontierDepthBuffer;
+        std::list<prop_t> rpaoDepthBuffer;
+        std::list<prop_t> ciaoListDepth;
+        std::list<long> ciaoListNum;
+        std::list<prop_t> ciaoDepthBuffer;
+        std::list<prop_t> vidxDepthBuffer;
+        prop_t decodeDepth;
+
+        // The compressed ciao bytes wait in ciaoByteBuffer to be decoded, 
+        // and ciaoLenBuffer keeps the length of each requested list.
+        std::list<char> ciaoByteBuffer;
+        std::list<long> ciaoLenBuffer;
+        CiaoCodec ciaoDecoder;
+        long ciaoReadBytes;
+        long ciaoDecodedNum;
+        long ciaoDecodeCycles;
+
+        // Vertices sent from the other pes to update their depth, 
+        // with the arrival time in ps.
+        std::list<std::pair<long, vidx_t>> remoteVidxBuffer;
+        std::list<prop_t> remoteDepthBuffer;
+        long remoteUpdateNum;
+
+        // Frontier queues of the sparse mode. The vertices visited in a 
+        // level are appended to the next queue through frontierWriteBuffer, 
+        // and the next level reads the queue instead of scanning the depth.
+        // The size of the next queues of all the pes and their overflow 
+        // are kept per level parity, as they decide the mode of the level.
+        // nextQueued marks the local vertices in the next queue, so that 
+        // a vertex written more than once in a level is queued once.
+        bool sparse;
+        int queueIdx;
+        long curQueueSize;
+        long nextQueueSize;
+        long nextQueueWritten;
+        long queueReadLen;
+        std::list<vidx_t> frontierWriteBuffer;
+        std::vector<bool> nextQueued;
+        static long queueTotal[2];
+        static bool queueOverflow[2];
+        static int sparseLevelNum;
+
+        // # and bytes of the bursts split from the long streams.
+        long splitBurstNum;
+        long splitBurstBytes;
+
+        // Request credits held by each port and the pe cycles in which 
+        // the burst at the head of the port is stalled for the credits 
+        // (bounded reqQueueDepth only).
+        std::vector<long> reqCredits;
+        std::vector<long> stallCycles;
+
+        // Asynchronous bfs. The vertices whose property is lowered wait 
+        // in workBuckets by their property and the lowest bucket is 
+        // expanded first. pendingDepth keeps the (property written, or 
+        // -1, and # of reads and writes in flight) of the vertices being 
+        // updated, so that a read sees the writes that have not landed 
+        // (VertexProgram::isForwarded() only), and asyncWrites maps the 
+        // write bursts to their vertices.
+        std::map<prop_t, std::list<vidx_t>> workBuckets;
+        std::map<vidx_t, std::pair<prop_t, int>> pendingDepth;
+        std::map<long, vidx_t> asyncWrites;
+        long expandedNum;
+        long correctedNum;
 
 
         std::vector<std::list<long>> burstReqQueue;
@@ -89,9 +176,22 @@ class pe : public sc_module{
         std::map<long, bool> burstOpStatus;
 
         bool isBurstReqQueueEmpty();
+        void waitReqSlot(int portIdx);
         bool isBurstRespQueueEmpty();
         void init();
         bool isEndOfBfsIteration();
+        bool isEndOfLocalIteration();
+        bool isFrontierEmpty();
+        bool isExpandDrained();
+        bool isAsyncDone();
+        void releasePendingDepth(vidx_t vidx);
+        prop_t popProp(std::list<char> &buffer);
+        void pushProp(std::list<char> &buffer, prop_t prop);
+        void reportBfs();
+        long getQueueAddr(int q);
+        int getBaseLen(int portIdx);
+        void startLevel();
+        void appendNextFrontier(vidx_t vidx);
         //bool isAllReqProcessed();
         long getReadyOp();
 
@@ -113,20 +213,24 @@ class pe : public sc_module{
         void processExpandRpaoReadResp();
         void issueExpandCiaoReadReq();
         void processExpandCiaoReadResp();
+        void decodeExpandCiao();
+        void processRemoteUpdate();
+        void reportCiaoTraffic();
         void issueExpandDepthReadReq();
         void processExpandDepthReadResp();
         void expandDepthAnalysis();
         void processExpandDepthWriteResp();
+        void issueFrontierWriteReq();
 
         void inspectDepthReqThread(
                 long baseDepthMemAddr,
                 int prIdx,
                 int portIdx,
-                int maxLen
+                long maxLen
                 );
 
         void inspectDepthRespThread(
-                int expectedLen,
+                long expectedLen,
                 int portIdx,
                 int prIdx
                 );
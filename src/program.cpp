@@ -0,0 +1,204 @@
+#include "program.h"
+#include <cstring>
+
+namespace{
+
+// The pagerank accumulator keeps the iteration in the upper 16 bits and
+// the fixed point rank in the lower 48 bits.
+const int rankBits = 48;
+const uint64_t rankMask = (1ULL << rankBits) - 1;
+
+prop_t packRank(int iteration, int64_t rank){
+    return (prop_t)(((uint64_t)(uint16_t)iteration << rankBits) | ((uint64_t)rank & rankMask));
+}
+
+int getIteration(prop_t prop){
+    return (int16_t)((uint64_t)prop >> rankBits);
+}
+
+int64_t getAccRank(prop_t prop){
+    return (int64_t)((uint64_t)prop << (64 - rankBits)) >> (64 - rankBits);
+}
+
+}
+
+int VertexProgram::getPropSize(){
+    if(GL::algorithm == Algorithm::BFS){
+        return (int)sizeof(signed char);
+    }
+    if(GL::algorithm == Algorithm::PAGERANK){
+        return (int)sizeof(int64_t);
+    }
+    return (int)sizeof(int32_t);
+}
+
+int VertexProgram::getPropArrayNum(){
+    return (GL::algorithm == Algorithm::PAGERANK) ? 2 : 1;
+}
+
+int VertexProgram::getReadSlot(int level){
+    return level % getPropArrayNum();
+}
+
+int VertexProgram::getWriteSlot(int level){
+    return (level + 1) % getPropArrayNum();
+}
+
+int VertexProgram::getEdgeSize(){
+    if(GL::algorithm == Algorithm::SSSP){
+        return (int)sizeof(vidx_t) * 2;
+    }
+    return (int)sizeof(vidx_t);
+}
+
+// The weights in [1, maxEdgeWeight] are derived from the original vertex 
+// indices, so that the weights do not change with the vertexOrder.
+int VertexProgram::getEdgeWeight(vidx_t src, vidx_t dst){
+    uint64_t h = (uint64_t)src * 2654435761u + (uint64_t)dst * 40503u;
+    return 1 + (int)(h % (uint64_t)GL::maxEdgeWeight);
+}
+
+bool VertexProgram::isAsync(){
+    return GL::asyncBfs != 0 || GL::algorithm == Algorithm::SSSP || GL::algorithm == Algorithm::CC;
+}
+
+bool VertexProgram::isRooted(){
+    return GL::algorithm == Algorithm::BFS || GL::algorithm == Algorithm::SSSP;
+}
+
+bool VertexProgram::isForwarded(){
+    return isAsync() || GL::algorithm != Algorithm::BFS;
+}
+
+prop_t VertexProgram::getInitProp(vidx_t vidx){
+    if(GL::algorithm == Algorithm::CC){
+        return vidx;
+    }
+    if(GL::algorithm == Algorithm::PAGERANK){
+        return packRank(-1, 0);
+    }
+    return -1;
+}
+
+prop_t VertexProgram::getRootProp(){
+    return 0;
+}
+
+bool VertexProgram::isActive(prop_t prop, int level, prop_t &value){
+    value = prop;
+    switch(GL::algorithm){
+        case Algorithm::BFS:
+            return prop == level;
+        case Algorithm::SSSP:
+            return level == 0 && prop == 0;
+        case Algorithm::CC:
+            return level == 0;
+        case Algorithm::PAGERANK:
+            value = getRank(prop, level);
+            return level < GL::pageRankIterNum;
+    }
+    return false;
+}
+
+prop_t VertexProgram::scatter(prop_t value, long degree){
+    if(GL::algorithm == Algorithm::BFS){
+        return value + 1;
+    }
+    if(GL::algorithm == Algorithm::PAGERANK){
+        return value / degree;
+    }
+    return value;
+}
+
+prop_t VertexProgram::traverse(prop_t value, int weight){
+    if(GL::algorithm == Algorithm::SSSP){
+        return value + weight;
+    }
+    return value;
+}
+
+bool VertexProgram::apply(prop_t &prop, prop_t value, int level){
+    if(GL::algorithm == Algorithm::PAGERANK){
+        int64_t acc = (getIteration(prop) == level + 1) ? getAccRank(prop) : 0;
+        prop = packRank(level + 1, acc + value);
+        return true;
+    }
+    if((prop == -1 && GL::algorithm != Algorithm::CC) || value < prop){
+        prop = value;
+        return true;
+    }
+    return false;
+}
+
+prop_t VertexProgram::getProp(const char* p){
+    if(getPropSize() == (int)sizeof(signed char)){
+        return (signed char)p[0];
+    }
+    if(getPropSize() == (int)sizeof(int32_t)){
+        int32_t prop;
+        memcpy(&prop, p, sizeof(prop));
+        return prop;
+    }
+    int64_t prop;
+    memcpy(&prop, p, sizeof(prop));
+    return prop;
+}
+
+void VertexProgram::setProp(char* p, prop_t prop){
+    if(getPropSize() == (int)sizeof(signed char)){
+        p[0] = (char)prop;
+    }
+    else if(getPropSize() == (int)sizeof(int32_t)){
+        int32_t val = (int32_t)prop;
+        memcpy(p, &val, sizeof(val));
+    }
+    else{
+        memcpy(p, &prop, sizeof(prop));
+    }
+}
+
+int VertexProgram::getResultSlot(){
+    if(GL::algorithm == Algorithm::PAGERANK){
+        return getReadSlot(GL::pageRankIterNum);
+    }
+    return 0;
+}
+
+void VertexProgram::printResult(std::ostream &os, prop_t prop){
+    if(GL::algorithm == Algorithm::PAGERANK){
+        os << getPageRank(prop);
+    }
+    else{
+        os << (long)prop;
+    }
+}
+
+double VertexProgram::getPageRank(prop_t prop){
+    return (double)getRank(prop, GL::pageRankIterNum) / (1L << rankFracBits);
+}
+
+const char* VertexProgram::getName(){
+    switch(GL::algorithm){
+        case Algorithm::BFS:
+            return "BFS";
+        case Algorithm::SSSP:
+            return "SSSP";
+        case Algorithm::CC:
+            return "CC";
+        case Algorithm::PAGERANK:
+            return "PageRank";
+    }
+    return "";
+}
+
+// The rank of an iteration is (1 - d) / N + d * the rank received in the
+// previous iteration with the damping factor d of 0.85, and all the
+// vertices start from 1 / N.
+prop_t VertexProgram::getRank(prop_t prop, int level){
+    prop_t one = 1L << rankFracBits;
+    if(level == 0){
+        return one / GL::vertexNum;
+    }
+    prop_t acc = (getIteration(prop) == level) ? getAccRank(prop) : 0;
+    return one * 15 / (100 * GL::vertexNum) + acc * 85 / 100;
+}
@@ -0,0 +1,89 @@
+#ifndef __PROGRAM_H__
+#define __PROGRAM_H__
+
+#include <iostream>
+#include <cstdint>
+#include "common.h"
+
+// Vertex property carried through the pe pipeline. It takes
+// VertexProgram::getPropSize() bytes in the depth array.
+typedef int64_t prop_t;
+
+// The graph algorithm run by the pe pipeline, selected with GL::algorithm.
+// Each vertex keeps a property in the depth array. The active vertices
+// scatter a value along their outgoing edges, and the value is applied to
+// the property of each neighbour.
+//   bfs       1-byte depth, -1 when unvisited. The vertices at the level
+//             are active, and a neighbour takes depth + 1 when it is
+//             smaller.
+//   sssp      4-byte distance from the starting vertex, -1 when unreached.
+//             Each neighbour in ciao is followed by the weight of the
+//             edge, and a neighbour takes distance + weight when it is
+//             smaller.
+//   cc        4-byte label, which starts from the vertex index. All the
+//             vertices are active at first, and a neighbour takes the
+//             label when it is smaller. The labels are the connected
+//             components when the graph has both directions of the edges.
+//   pagerank  Two 8-byte accumulators of the rank received from the
+//             neighbours, one per iteration parity, tagged with the
+//             iteration. Each level runs an iteration, in which all the
+//             vertices are active and scatter rank / out-degree to the
+//             accumulators of the next iteration. The ranks are fixed
+//             point numbers with rankFracBits fraction bits, which
+//             resolve 1 / N on graphs of billions of vertices, and the
+//             rank of the vertices without outgoing edges is dropped.
+// sssp and cc run on the asynchronous engine, see GL::asyncBfs.
+class VertexProgram{
+    public:
+        static const int rankFracBits = 46;
+
+        // Layout of the properties and the edges in the memory. The
+        // depth array holds getPropArrayNum() arrays of the properties,
+        // and the level reads the array of getReadSlot() in the inspection
+        // and updates the array of getWriteSlot().
+        static int getPropSize();
+        static int getPropArrayNum();
+        static int getReadSlot(int level);
+        static int getWriteSlot(int level);
+        static int getEdgeSize();
+        // The weight of the edge between the original vertex indices.
+        static int getEdgeWeight(vidx_t src, vidx_t dst);
+
+        static bool isAsync();
+        static bool isRooted();
+
+        // The reads of the properties take the updates in flight when a
+        // property may be updated more than once before its write lands.
+        static bool isForwarded();
+
+        static prop_t getInitProp(vidx_t vidx);
+        static prop_t getRootProp();
+
+        // Whether the vertex of prop is active at level, and the value
+        // it holds when it is.
+        static bool isActive(prop_t prop, int level, prop_t &value);
+
+        // The value scattered by a vertex of degree outgoing edges, and
+        // the value that reaches the neighbour through an edge of weight.
+        static prop_t scatter(prop_t value, long degree);
+        static prop_t traverse(prop_t value, int weight);
+
+        // Apply the value to the property of a neighbour at level. It
+        // returns true when the property is changed and must be written.
+        static bool apply(prop_t &prop, prop_t value, int level);
+
+        static prop_t getProp(const char* p);
+        static void setProp(char* p, prop_t prop);
+
+        // The result of a vertex of prop at the end of the algorithm,
+        // which is found in the array of getResultSlot().
+        static int getResultSlot();
+        static void printResult(std::ostream &os, prop_t prop);
+        static double getPageRank(prop_t prop);
+        static const char* getName();
+
+    private:
+        static prop_t getRank(prop_t prop, int level);
+};
+
+#endif